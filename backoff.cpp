@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cmath>
+
+#include "include/cprex/backoff.h"
+#include "include/cprex/random.h"
+
+namespace cprex
+{
+namespace Backoff
+{
+// Beyond that 2^attempt exceeds any sensible maxDelay anyway.
+static constexpr double MaxExponent = 62;
+
+static std::chrono::milliseconds Capped(double milliSeconds, std::chrono::milliseconds maxDelay)
+{
+    const double max = static_cast<double>(maxDelay.count());
+    return std::chrono::milliseconds(static_cast<int64_t>(std::clamp(milliSeconds, 0.0, max)));
+}
+
+static double Exponential(double base, size_t attempt)
+{
+    return base * std::exp2(std::min(static_cast<double>(attempt), MaxExponent));
+}
+
+BackofPolicy CappedExponential(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay)
+{
+    const double base = static_cast<double>(medianFirstDelay.count());
+    return [=](size_t attempt) { return Capped(Exponential(base, attempt), maxDelay); };
+}
+
+BackofPolicy FullJitter(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay)
+{
+    const double base = 2.0 * medianFirstDelay.count();
+    const double max  = static_cast<double>(maxDelay.count());
+    return [=](size_t attempt) {
+        return Capped(Random::NextDouble() * std::min(Exponential(base, attempt), max), maxDelay);
+    };
+}
+
+BackofPolicy EqualJitter(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay)
+{
+    const double base = 4.0 / 3.0 * medianFirstDelay.count();
+    const double max  = static_cast<double>(maxDelay.count());
+    return [=](size_t attempt) {
+        const double half = std::min(Exponential(base, attempt), max) / 2;
+        return Capped(half + Random::NextDouble() * half, maxDelay);
+    };
+}
+
+BackofPolicy DecorrelatedJitterV2(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay)
+{
+    // The constants of Polly, chosen such that the median of the first delay is medianFirstDelay.
+    static constexpr double PFactor         = 4.0;
+    static constexpr double RpScalingFactor = 1 / 1.4;
+
+    const double target = static_cast<double>(medianFirstDelay.count());
+    return [=](size_t attempt) {
+        auto formula = [](double t) { return std::exp2(t) * std::tanh(std::sqrt(PFactor * t)); };
+
+        const double exponent = std::min(static_cast<double>(attempt), MaxExponent);
+        const double next     = formula(exponent + Random::NextDouble());
+        const double prev     = attempt ? formula(exponent - 1 + Random::NextDouble()) : 0.0;
+
+        return Capped((next - prev) * RpScalingFactor * target, maxDelay);
+    };
+}
+}
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "include/cprex/cprex.h"
+#include "include/cprex/multi.h"
+#include "test/server.h"
+
+// Per request overhead of cprex over a raw cpr::Session. All variants GET the same empty reply from a TestServer on
+// loopback, so the differences are cprex's preparation, retry bookkeeping, metrics and pooling.
+// Given the URL of an HTTP/2 server, e.g. a local nghttpd, it also compares concurrent MultiSession requests over
+// HTTP/1.1 and HTTP/2 and the connections each opened, with at most 100 requests in flight.
+// Usage: cprex_bench [requests [h2-url]], 10000 requests by default.
+
+using Clock = std::chrono::steady_clock;
+
+static void Print(const std::string& name, Clock::duration elapsed, size_t requests)
+{
+    const auto us = std::chrono::duration<double, std::micro>(elapsed).count() / requests;
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << us << " us/request";
+}
+
+template <typename Get>
+static void Measure(const char* name, size_t requests, Get get)
+{
+    // Leaves the first connections and allocations out.
+    for (size_t i = 0; i < requests / 10; ++i)
+        get();
+
+    const auto started = Clock::now();
+    for (size_t i = 0; i < requests; ++i)
+        get();
+
+    Print(name, Clock::now() - started, requests);
+    std::cout << std::endl;
+}
+
+// All requests are submitted at once, so HTTP/2 multiplexes them over few connections.
+static void MeasureMultiplexing(const std::string& url, size_t requests)
+{
+    const auto http2 = url.starts_with("https:") ? cprex::HttpVersion::Http2 : cprex::HttpVersion::Http2PriorKnowledge;
+    for (const auto& [name, version] :
+        {std::pair {"MultiSession HTTP/1.1", cprex::HttpVersion::Http1_1}, std::pair {"MultiSession HTTP/2", http2}})
+    {
+        cprex::Factory::PrepareSession(
+            name, url, {}, {}, {}, {0, 0, cprex::DefaultJitterBackofPolicy}, {.httpVersion = version});
+        auto multi = cprex::Factory::CreateMulti(name);
+
+        const auto                        started = Clock::now();
+        std::vector<cprex::AsyncResponse> responses;
+        for (size_t i = 0; i < requests; ++i)
+            responses.push_back(multi.Get(cprex::Path("")));
+        for (auto& response : responses)
+            response.wait();
+
+        Print(name, Clock::now() - started, requests);
+        std::cout << std::setw(8) << cprex::Factory::SessionMetrics(name).newConnections << " connections" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const size_t requests = argc > 1 ? std::stoul(argv[1]) : 10000;
+
+    cprex::test::TestServer server;
+    cprex::Factory::PrepareSession("bench", server.Url(), {}, {}, {}, {0, 0, cprex::DefaultJitterBackofPolicy});
+
+    cpr::Session raw;
+    raw.SetUrl(cpr::Url {server.Url() + "bench"});
+    Measure("cpr::Session", requests, [&raw] { raw.Get(); });
+
+    auto session = cprex::Factory::CreateSession("bench");
+    Measure("cprex::Session", requests, [&session] { session.Get(cprex::Path("bench")); });
+
+    Measure("cprex::AcquireSession", requests,
+        [] { cprex::Factory::AcquireSession("bench")->Get(cprex::Path("bench")); });
+
+    // Each HTTP/1.1 request in flight holds a connection of its own.
+    if (argc > 2)
+        MeasureMultiplexing(argv[2], std::min<size_t>(requests, 100));
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+
+#include "include/cprex/breaker.h"
+
+namespace cprex
+{
+CircuitBreaker::CircuitBreaker(const BreakerOptions& options)
+    : _options(options)
+    , _slotWidth(std::max<int64_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(options.samplingDuration).count() / Buckets, 1))
+{
+}
+
+bool CircuitBreaker::IsFailure(int curlError, long statusCode)
+{
+    return curlError != 0 || statusCode == 408 || statusCode == 429 || statusCode >= 500;
+}
+
+bool CircuitBreaker::Allow()
+{
+    State state = _state.load(std::memory_order_relaxed);
+    if (state == State::Closed)
+        return true;
+
+    const int64_t time = now();
+    if (state == State::Open)
+    {
+        if (time < _openUntil.load(std::memory_order_relaxed))
+            return false;
+
+        // The first one to notice the break is over lets the probes through.
+        if (_state.compare_exchange_strong(state, State::HalfOpen))
+        {
+            _probes      = 0;
+            _probesSince = time;
+        }
+    }
+
+    // Probes which never reported back must not keep the circuit half open for good.
+    int64_t since = _probesSince.load(std::memory_order_relaxed);
+    if (time - since >= std::chrono::duration_cast<std::chrono::milliseconds>(_options.probeTimeout).count() &&
+        _probesSince.compare_exchange_strong(since, time))
+        _probes = 0;
+
+    if (_probes.fetch_add(1) < _options.halfOpenProbes)
+        return true;
+
+    _probes.fetch_sub(1);
+    return false;
+}
+
+void CircuitBreaker::Record(bool success)
+{
+    const int64_t time = now();
+    const int64_t slot = time / _slotWidth;
+
+    auto& current = bucket(slot);
+    (success ? current.successes : current.failures).fetch_add(1, std::memory_order_relaxed);
+
+    switch (_state.load(std::memory_order_relaxed))
+    {
+        case State::Closed:
+            break;
+        case State::Open:
+            // A request allowed before the circuit opened.
+            return;
+        case State::HalfOpen:
+            if (success)
+                close();
+            else
+                open(time);
+            return;
+    }
+
+    // Only failures can open the circuit, successes are done here.
+    if (success)
+        return;
+
+    uint64_t successes = 0;
+    uint64_t failures  = 0;
+    for (auto& b : _buckets)
+    {
+        if (b.slot.load(std::memory_order_relaxed) > slot - static_cast<int64_t>(Buckets))
+        {
+            successes += b.successes.load(std::memory_order_relaxed);
+            failures += b.failures.load(std::memory_order_relaxed);
+        }
+    }
+
+    const uint64_t total = successes + failures;
+    if (total >= _options.minimumThroughput && failures >= _options.failureRatio * total)
+        open(time);
+}
+
+void CircuitBreaker::Abandon()
+{
+    if (_state.load(std::memory_order_relaxed) != State::HalfOpen)
+        return;
+
+    // Requests allowed while closed hold no slot, so the count must not wrap around.
+    size_t probes = _probes.load(std::memory_order_relaxed);
+    while (probes && !_probes.compare_exchange_weak(probes, probes - 1))
+    {
+    }
+}
+
+int64_t CircuitBreaker::now() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+}
+
+CircuitBreaker::Bucket& CircuitBreaker::bucket(int64_t slot)
+{
+    auto& b = _buckets[slot % Buckets];
+    if (b.slot.load(std::memory_order_acquire) != slot)
+    {
+        // Counts racing with the reset may get lost, which doesn't matter for a ratio.
+        std::lock_guard<std::mutex> lock(_rollMtx);
+        if (b.slot.load(std::memory_order_relaxed) != slot)
+        {
+            b.successes = 0;
+            b.failures  = 0;
+            b.slot.store(slot, std::memory_order_release);
+        }
+    }
+    return b;
+}
+
+void CircuitBreaker::open(int64_t now)
+{
+    _openUntil = now + std::chrono::duration_cast<std::chrono::milliseconds>(_options.breakDuration).count();
+    _state     = State::Open;
+}
+
+void CircuitBreaker::close()
+{
+    // Start over with an empty window, the failures which opened the circuit are history.
+    {
+        std::lock_guard<std::mutex> lock(_rollMtx);
+        for (auto& b : _buckets)
+            b.slot = -1;
+    }
+    _state = State::Closed;
+}
+}
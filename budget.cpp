@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include "include/cprex/budget.h"
+
+namespace cprex
+{
+RetryBudget::RetryBudget(const RetryBudgetOptions& options)
+    : _deposit(static_cast<int64_t>(options.ratio * Scale))
+    , _perMillisecond(options.minRetriesPerSecond)
+    , _max(static_cast<int64_t>(options.maxBalance * Scale))
+    , _balance(_max)
+    , _lastRefill(now())
+{
+}
+
+void RetryBudget::Deposit()
+{
+    // May overshoot _max a little when racing, which is trimmed by the next refill.
+    if (_balance.load(std::memory_order_relaxed) < _max)
+        _balance.fetch_add(_deposit, std::memory_order_relaxed);
+}
+
+bool RetryBudget::TryWithdraw()
+{
+    refill();
+
+    int64_t balance = _balance.load(std::memory_order_relaxed);
+    while (balance >= Scale)
+    {
+        if (_balance.compare_exchange_weak(balance, balance - Scale, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+int64_t RetryBudget::now() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void RetryBudget::refill()
+{
+    // minRetriesPerSecond tokens per second are minRetriesPerSecond thousandths per millisecond.
+    const int64_t time = now();
+    int64_t       last = _lastRefill.load(std::memory_order_relaxed);
+    if (time <= last || !_lastRefill.compare_exchange_strong(last, time, std::memory_order_relaxed))
+        return;
+
+    const int64_t earned  = static_cast<int64_t>((time - last) * _perMillisecond);
+    int64_t       balance = _balance.load(std::memory_order_relaxed);
+    while (!_balance.compare_exchange_weak(balance, std::min(balance + earned, _max), std::memory_order_relaxed))
+    {
+    }
+}
+}
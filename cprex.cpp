@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "include/cprex/cprex.h"
+#include "include/cprex/multi.h"
 using namespace std::chrono_literals;
 
 namespace cprex
@@ -8,25 +9,23 @@ namespace cprex
 std::string AppendUrls(const std::string& baseUrl, const std::string& otherUrl)
 {
     std::string res;
-    if (otherUrl.empty())
-    {
-        res = baseUrl;
-    }
-    else
+    AppendUrls(res, baseUrl, otherUrl);
+    return res;
+}
+
+void AppendUrls(std::string& url, std::string_view baseUrl, std::string_view otherUrl)
+{
+    if (IsAbsoluteUrl(otherUrl))
     {
-        if (IsAbsoluteUrl(otherUrl))
-        {
-            res = otherUrl;
-        }
-        else
-        {
-            if (otherUrl.front() == '/')
-                res = baseUrl + otherUrl.substr(1);
-            else
-                res = baseUrl + otherUrl;
-        }
+        url.assign(otherUrl);
+        return;
     }
-    return res;
+
+    if (!otherUrl.empty() && otherUrl.front() == '/')
+        otherUrl.remove_prefix(1);
+
+    url.assign(baseUrl);
+    url.append(otherUrl);
 }
 
 namespace StatusCode
@@ -50,187 +49,411 @@ bool CanRetry(long statusCode)
 }
 }
 
-const BackofPolicy DefaultExponentialBackofPolicy = [](size_t attempt) {
-    // TODO add decorrelation jitter:
-    // https://github.com/App-vNext/Polly/wiki/Retry-with-jitter
-    // https://www.pollydocs.org/strategies/retry
-    // https://github.com/Polly-Contrib/Polly.Contrib.WaitAndRetry/tree/master
-    // https://github.com/Polly-Contrib/Polly.Contrib.WaitAndRetry/blob/master/src/Polly.Contrib.WaitAndRetry/Backoff.DecorrelatedJitterV2.cs
+const BackofPolicy DefaultExponentialBackofPolicy = Backoff::CappedExponential(100ms, 10min);
+const BackofPolicy DefaultJitterBackofPolicy      = Backoff::DecorrelatedJitterV2(100ms, 10min);
 
-    if (attempt > 12)
-        return std::chrono::milliseconds(10min);
-
-    size_t milliSeconds = 100 << attempt;
-
-    return std::chrono::milliseconds(milliSeconds);
-};
-
-const RetryPolicy DefaultRetryPolicy {5, 4, DefaultExponentialBackofPolicy};
+const RetryPolicy DefaultRetryPolicy {5, 4, DefaultJitterBackofPolicy};
 
 void Session::EnableTrace()
 {
+    _traceAll = true;
+}
+
+void Session::trace(RetryState& state)
+{
+    if (!state.traceDecided)
+    {
+        state.traceDecided = true;
+        state.traceId      = Tracer::Sample(_traceAll ? 1.0 : _traceSampleRate);
+    }
+    _traceId      = state.traceId;
+    _traceAttempt = state.performed + 1;
+
     CURL* curl = _session.GetCurlHolder()->handle;
+    if (_traceId)
+    {
+        // https://curl.se/libcurl/c/debug.html
+        curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, curl_trace);
+        curl_easy_setopt(curl, CURLOPT_DEBUGDATA, this);
 
-    // https://curl.se/libcurl/c/debug.html
+        // the DEBUGFUNCTION has no effect until we enable VERBOSE
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+        _verbose = true;
+    }
+    else if (_verbose)
+    {
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 0L);
+        _verbose = false;
+    }
+}
 
-    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, curl_trace);
-    curl_easy_setopt(curl, CURLOPT_DEBUGDATA, &_debugData);
+int Session::curl_trace(CURL* handle, curl_infotype type, char* data, size_t size, void* userp)
+{
+    (void)handle; /* prevent compiler warning */
 
-    // the DEBUGFUNCTION has no effect until we enable VERBOSE
-    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+    auto session = static_cast<const Session*>(userp);
+    Factory::Tracing().Record(session->_name, session->_traceId, session->_traceAttempt, type, data, size);
+    return 0;
 }
 
-void Session::dump(const char* text, FILE* stream, unsigned char* ptr, size_t size, bool nohex)
+Response Session::makeHedgedRequestEx(const std::function<void(Session&)>& prepareHedge)
 {
-    size_t i;
-    size_t c;
+    RetryState state;
+
+    if (!admit(state))
+        return complete(CURLE_ABORTED_BY_CALLBACK, state);
+
+    prepare();
+
+    SessionLease hedge;
+    CURLcode     curl_error = performHedged(prepareHedge, hedge);
+    Session&     winner     = hedge ? *hedge : *this;
+
+    auto waitMilliSeconds = winner.nextAttempt(curl_error, state);
+    if (!waitMilliSeconds)
+    {
+        winner.finishAttempts(state);
+        return winner.complete(curl_error, state);
+    }
 
-    unsigned int width = 0x10;
+    // Further attempts aren't hedged, they run on this session as usual.
+    if (state.tempProxyDisabled && &winner != this)
+        _session.SetProxies({{}});
+    _traceAttempt = state.performed + 1;
 
-    if (nohex)
-        /* without the hex output, we can fit more on screen */
-        width = 0x40;
+    std::this_thread::sleep_for(*waitMilliSeconds);
+    prepare();
+    return complete(performAttempts(state, _prepper), state);
+}
+
+CURLcode Session::performHedged(const std::function<void(Session&)>& prepareHedge, SessionLease& hedge)
+{
+    CURL*      curl  = _session.GetCurlHolder()->handle;
+    const auto start = std::chrono::steady_clock::now();
+    auto       delay = _hedging->Begin();
 
-    fprintf(stream, "%s, %10.10lu bytes (0x%8.8lx)\n", text, (unsigned long)size, (unsigned long)size);
+    auto elapsed = [&start] {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    };
+
+    if (!delay)
+    {
+        CURLcode curl_error = curl_easy_perform(curl);
+        if (curl_error == CURLE_OK)
+            _hedging->RecordLatency(elapsed());
+        return curl_error;
+    }
 
-    for (i = 0; i < size; i += width)
+    // A multi handle of its own just to wait for two transfers at once.
+    if (!_hedgeMulti)
+        _hedgeMulti.reset(curl_multi_init());
+    CURLM* multi = _hedgeMulti.get();
+    curl_multi_add_handle(multi, curl);
+
+    CURL*    hedgeCurl  = nullptr;
+    CURL*    winner     = nullptr;
+    CURLcode curl_error = CURLE_OK;
+    int      running    = 1;
+    while (!winner)
     {
-        fprintf(stream, "%4.4lx: ", (unsigned long)i);
+        curl_multi_perform(multi, &running);
 
-        if (!nohex)
+        int      pending = 0;
+        CURLMsg* msg;
+        while ((msg = curl_multi_info_read(multi, &pending)))
         {
-            /* hex not disabled, show it */
-            for (c = 0; c < width; c++)
-                if (i + c < size)
-                    fprintf(stream, "%02x ", ptr[i + c]);
-                else
-                    fputs("   ", stream);
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            curl_error = msg->data.result;
+            winner     = msg->easy_handle;
+            if (curl_error == CURLE_OK)
+                break;
         }
+        // A failed transfer only wins if the other one is done as well.
+        if (winner && (curl_error == CURLE_OK || !running))
+            break;
+        winner = nullptr;
 
-        for (c = 0; (c < width) && (i + c < size); c++)
+        if (delay && elapsed() >= *delay)
         {
-            /* check for 0D0A; if found, skip past and start a new line of output */
-            if (nohex && (i + c + 1 < size) && ptr[i + c] == 0x0D && ptr[i + c + 1] == 0x0A)
+            // Only ever one hedge, whether the budget allows it or not.
+            delay.reset();
+            if ((!_breaker || _breaker->GetState() == CircuitBreaker::State::Closed) && _hedging->Fire())
             {
-                i += (c + 2 - width);
-                break;
-            }
-            fprintf(stream, "%c", (ptr[i + c] >= 0x20) && (ptr[i + c] < 0x80) ? ptr[i + c] : '.');
-            /* check again for 0D0A, to avoid an extra \n if it's at width */
-            if (nohex && (i + c + 2 < size) && ptr[i + c + 1] == 0x0D && ptr[i + c + 2] == 0x0A)
-            {
-                i += (c + 3 - width);
-                break;
+                hedge = Factory::AcquireSession(_name);
+                prepareHedge(*hedge);
+                hedge->_rejected = false;
+                hedge->prepare();
+
+                // Most probably this gets another server behind a load balancer than the slow connection.
+                hedgeCurl = hedge->_session.GetCurlHolder()->handle;
+                curl_easy_setopt(hedgeCurl, CURLOPT_FRESH_CONNECT, 1L);
+                curl_multi_add_handle(multi, hedgeCurl);
+                continue;
             }
         }
-        fputc('\n', stream); /* newline */
+
+        auto timeout = std::chrono::milliseconds(1000);
+        if (delay)
+            timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(*delay - elapsed()));
+        curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+    }
+
+    // The loser gets cancelled by removing it.
+    curl_multi_remove_handle(multi, curl);
+    if (hedgeCurl)
+    {
+        curl_multi_remove_handle(multi, hedgeCurl);
+        curl_easy_setopt(hedgeCurl, CURLOPT_FRESH_CONNECT, 0L);
     }
-    fflush(stream);
+
+    if (curl_error == CURLE_OK)
+        _hedging->RecordLatency(elapsed());
+
+    if (winner == hedgeCurl)
+        _hedging->Won();
+    else
+        hedge = SessionLease();
+
+    return curl_error;
 }
 
-int Session::curl_trace(CURL* handle, curl_infotype type, char* data, size_t size, void* userp)
+std::optional<std::chrono::milliseconds> Session::nextAttempt(CURLcode curl_error, RetryState& state, bool resumable)
 {
-    auto        config = (DebugData*)userp;
-    const char* text;
-    (void)handle; /* prevent compiler warning */
+    CURL* curl = _session.GetCurlHolder()->handle;
+
+    if (_rejected)
+        return std::nullopt;
+
+    _traceAttempt = ++state.performed + 1;
+
+    if (curl_error != CURLE_OK)
+        ++state.nonHttpErrors;
+
+    if (_proxyHealth && !state.tempProxyDisabled)
+        _proxyHealth->RecordRequest(curl_error == CURLE_OK);
+
+    auto&      attempt     = state.attempts.emplace_back(AttemptInfo::Read(curl, curl_error));
+    const long status_code = attempt.statusCode;
+    if (!state.tempProxyDisabled)
+        attempt.proxy = _proxy;
+
+    if (_metrics)
+        _metrics->RecordAttempt(attempt, state.performed == 1);
+
+    if (_breaker)
+        _breaker->Record(!CircuitBreaker::IsFailure(curl_error, status_code));
+
+    // Cut mid-body, e.g. CURLE_PARTIAL_FILE or CURLE_RECV_ERROR. A write error is the refusal of the body itself, which
+    // the next attempt would get again.
+    const bool cut = resumable && curl_error != CURLE_OK && curl_error != CURLE_WRITE_ERROR &&
+                     StatusCode::Succeeded(status_code);
 
-    switch (type)
+    if (StatusCode::Succeeded(status_code) && !cut)
     {
-        case CURLINFO_TEXT:
-            fprintf(stderr, "== Info: %s", data);
-            return 0;
-        case CURLINFO_HEADER_OUT:
-            text = "=> Send header";
-            break;
-        case CURLINFO_DATA_OUT:
-            text = "=> Send data";
-            break;
-        case CURLINFO_SSL_DATA_OUT:
-            text = "=> Send SSL data";
-            break;
-        case CURLINFO_HEADER_IN:
-            text = "<= Recv header";
-            break;
-        case CURLINFO_DATA_IN:
-            text = "<= Recv data";
-            break;
-        case CURLINFO_SSL_DATA_IN:
-            text = "<= Recv SSL data";
-            break;
-        default: /* in case a new one is introduced to shock us */
-            return 0;
+        // std::cout << "    Success(" << status_code << "): " << std::endl;
+        if (_retryBudget)
+            _retryBudget->Deposit();
+        if (state.tempProxyDisabled)
+            state.keepProxyDisabled = true;
+        return std::nullopt;
     }
 
-    dump(text, stderr, (unsigned char*)data, size, config->traceAscii);
-    return 0;
-}
+    if (_committed)
+        return std::nullopt;
 
-CURLcode Session::makeRepeatedRequestEx()
-{
-    CURL*    curl = _session.GetCurlHolder()->handle;
-    CURLcode curl_error;
-    size_t   attempt           = 0;
-    size_t   nonHttpErrors     = 0;
-    bool     tempProxyDisabled = false;
-    bool     keepProxyDisabled = false;
+    if (!StatusCode::CanRetry(status_code))
+    {
+        std::cout << "    Can't retry(" << status_code << "): " << std::endl;
+        return std::nullopt;
+    }
 
-    while (1)
+    if (state.attempt >= _retryPolicy.maxRetries)
     {
-        prepare();
+        std::cout << "    Failed and can't retry any more" << std::endl;
+        return std::nullopt;
+    }
 
-        curl_error = curl_easy_perform(curl);
-        if (curl_error != CURLE_OK)
-            ++nonHttpErrors;
+    // The circuit may have opened meanwhile, then don't add to the load. Asked first, so a rejected retry doesn't
+    // spend a token of the budget.
+    if (_breaker && !_breaker->Allow())
+    {
+        if (_metrics)
+            _metrics->RecordRejectedRetry(RetryRejection::CircuitOpen);
+        return std::nullopt;
+    }
 
-        long status_code = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
+    if (_retryBudget && !_retryBudget->TryWithdraw())
+    {
+        if (_metrics)
+            _metrics->RecordRejectedRetry(RetryRejection::BudgetExhausted);
+        if (_breaker)
+            _breaker->Abandon();
+        return std::nullopt;
+    }
 
-        if (StatusCode::Succeeded(status_code))
-        {
-            // std::cout << "    Success(" << status_code << "): " << std::endl;
-            if (tempProxyDisabled)
-                keepProxyDisabled = true;
-            break;
-        }
+    // Check whether there's a Retry-After header
+    auto       waitMilliSeconds = ParseRetryAfterHeader();
+    const bool retryAfter       = waitMilliSeconds != 0ms;
+    if (!retryAfter)
+        waitMilliSeconds = _retryPolicy.backofPolicy(state.attempt++);
 
-        if (!StatusCode::CanRetry(status_code))
-        {
-            std::cout << "    Can't retry(" << status_code << "): " << std::endl;
-            break;
-        }
+    attempt.wait       = waitMilliSeconds;
+    attempt.retryAfter = retryAfter;
 
-        if (attempt >= _retryPolicy.maxRetries)
-        {
-            std::cout << "    Failed and can't retry any more" << std::endl;
-            break;
-        }
+    if (_metrics)
+        _metrics->RecordRetry(status_code, retryAfter);
 
-        // Check whether there's a Retry-After header
-        auto waitMilliSeconds = ParseRetryAfterHeader();
-        if (waitMilliSeconds == 0ms)
-            waitMilliSeconds = _retryPolicy.backofPolicy(attempt++);
+    std::cout << "    Failed (" << state.attempt << ") with " << status_code << ", retry after " << waitMilliSeconds
+              << " ... " << std::endl;
 
-        std::cout << "    Failed (" << attempt << ") with " << status_code << ", retry after " << waitMilliSeconds
-                  << " ... " << std::endl;
+    // In proxied request case if we have enabled a fallback to direct and there were enough attempts w/o any
+    // response from server.
+    if (_retryPolicy.directFallbackThreshold > 0 && state.nonHttpErrors > _retryPolicy.directFallbackThreshold)
+    {
+        if (_metrics && !state.tempProxyDisabled)
+            _metrics->RecordDirectFallback();
 
-        // In proxied request case if we have enabled a fallback to direct and there were enough attempts w/o any
-        // response from server.
-        if (_retryPolicy.directFallbackThreshold > 0 && nonHttpErrors > _retryPolicy.directFallbackThreshold)
-        {
-            // Temp disable proxy
-            _session.SetProxies({{}});
-            tempProxyDisabled = true;
-        }
+        // Temp disable proxy
+        _session.SetProxies({{}});
+        state.tempProxyDisabled = true;
+    }
 
-        std::this_thread::sleep_for(waitMilliSeconds);
-    };
+    return waitMilliSeconds;
+}
 
-    if (tempProxyDisabled && !keepProxyDisabled)
+void Session::finishAttempts(const RetryState& state)
+{
+    if (state.tempProxyDisabled && !state.keepProxyDisabled)
     {
         RestoreProxy();
     }
 
-    return curl_error;
+    // Async requests set it again with their options on every attempt.
+    detachUpload();
+}
+
+void Session::updateResolve()
+{
+    _resolveGeneration = _resolver->Generation();
+    _resolveList       = _resolver->Current();
+    curl_easy_setopt(_session.GetCurlHolder()->handle, CURLOPT_RESOLVE, _resolveList.get());
+}
+
+void Session::detachUpload()
+{
+    if (_upload)
+    {
+        UploadSource::detach(_session.GetCurlHolder()->handle);
+        _upload = UploadSource();
+    }
+}
+
+bool Session::admit(RetryState& state)
+{
+    _rejected = state.performed == 0 && _breaker && !_breaker->Allow();
+    if (_rejected)
+        return false;
+
+    if (state.performed == 0)
+        state.started = std::chrono::steady_clock::now();
+    trace(state);
+    return true;
+}
+
+void Session::abandon()
+{
+    if (_breaker)
+        _breaker->Abandon();
+}
+
+Response Session::complete(CURLcode curl_error, RetryState& state)
+{
+    if (!_rejected)
+        return withAttempts(_session.Complete(curl_error), state);
+
+    // No attempt ran, thus finishAttempts() didn't either.
+    detachUpload();
+
+    Response response;
+    response.url   = _requestUrl;
+    response.error = cpr::Error(CURLE_ABORTED_BY_CALLBACK, "Circuit open for " + _name);
+    return withAttempts(std::move(response), state);
+}
+
+Response Session::completeDownload(CURLcode curl_error, RetryState& state)
+{
+    return _rejected ? complete(curl_error, state) : withAttempts(_session.CompleteDownload(curl_error), state);
+}
+
+Response Session::withAttempts(Response response, RetryState& state)
+{
+    response.attempts = std::move(state.attempts);
+
+    if (_slowRequests && !response.attempts.empty())
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - state.started;
+        _slowRequests->Record(response, std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+    }
+    return response;
+}
+
+StreamOptions Session::streamOptions() const
+{
+    return Factory::FindEntry(_name)->options.stream;
+}
+
+SessionLease Session::acquire() const
+{
+    return Factory::AcquireSession(_name);
+}
+
+void Session::enqueueStream(SessionLease lease, std::shared_ptr<BodyStream::State> state)
+{
+    Factory::Streams().enqueue(std::move(lease), [state](Response response) {
+        BodyStream::finish(state, std::move(response));
+    });
+}
+
+void Session::runAsync(std::shared_ptr<AsyncRequest> request)
+{
+    Factory::Workers().Submit([request = std::move(request)] {
+        std::optional<SessionLease> lease;
+        CURLcode                    curl_error = CURLE_ABORTED_BY_CALLBACK;
+        try
+        {
+            lease.emplace(Factory::AcquireSession(request->name));
+            auto& session = **lease;
+
+            request->prepare(session);
+            if (request->state.tempProxyDisabled)
+                session._session.SetProxies({{}});
+
+            if (session.admit(request->state))
+            {
+                session.prepare();
+                curl_error = curl_easy_perform(session._session.GetCurlHolder()->handle);
+            }
+
+            auto waitMilliSeconds = session.nextAttempt(curl_error, request->state);
+            session.finishAttempts(request->state);
+            if (waitMilliSeconds)
+            {
+                // Release the worker and the session while waiting, the next attempt is submitted again once due.
+                Factory::RetryScheduler().Schedule(*waitMilliSeconds, [request] { runAsync(request); });
+                return;
+            }
+        }
+        catch (...)
+        {
+            // The worker survives and the caller gets its answer.
+            request->fail(std::current_exception());
+            return;
+        }
+
+        request->complete(**lease, curl_error, request->state);
+    });
 }
 
 static std::time_t HttpDate(const char* v)
@@ -282,35 +505,25 @@ std::chrono::milliseconds Session::ParseRetryAfterHeader()
         return 0ms;
 }
 
-void Session::prepare()
+void Session::prepareSink(FileSink& sink)
+{
+    _session.PrepareGet();
+    sink.attach(_session.GetCurlHolder()->handle);
+}
+
+Response Session::closeSink(FileSink& sink, Response response)
 {
-    if (_prepper)
+    try
     {
-        _prepper(this);
+        sink.Close();
     }
-    else
+    catch (std::exception* e)
     {
-        if (_prepperArgs.index() == 0)
-        {
-            auto file = std::get<0>(_prepperArgs);
-            _prepperDlStream(this, *file);
-        }
-        else
-        {
-            auto write = std::get<1>(_prepperArgs);
-            _prepperDlCallback(this, *write);
-        }
+        if (!response.error)
+            response.error = cpr::Error(CURLE_WRITE_ERROR, e->what());
+        delete e;
     }
-}
-
-cpr::Response Session::makeRequestEx()
-{
-    return _session.Complete(makeRepeatedRequestEx());
-}
-
-cpr::Response Session::makeDownloadRequestEx()
-{
-    return _session.CompleteDownload(makeRepeatedRequestEx());
+    return response;
 }
 
 void Session::PrepareDelete()
@@ -359,111 +572,278 @@ void Session::PrepareDownload(const cpr::WriteCallback& write)
 }
 
 
-std::map<std::string, Factory::Entry> Factory::_namedSessionsData;
-pxProxyFactory*                       Factory::_proxyFactory = nullptr;
-std::mutex                            Factory::_proxyFactoryMtx;
+std::map<std::string, std::shared_ptr<const Factory::Entry>> Factory::_namedSessionsData;
+std::shared_mutex                                            Factory::_namedSessionsMtx;
+size_t                                                       Factory::_workerThreads = 0;
 
-Factory::Entry::Entry()
+std::shared_ptr<const Factory::Entry> Factory::FindEntry(const std::string& name)
 {
-    // https://everything.curl.dev/helpers/sharing.html
-    share = curl_share_init();
-    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
-    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
-    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
-    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    auto entry = LookupEntry(name);
+    if (!entry)
+        throw new std::exception("CreateNamedSession can't find name");
+
+    return entry;
 }
 
-Factory::Entry::~Entry()
+std::shared_ptr<const Factory::Entry> Factory::LookupEntry(const std::string& name)
 {
-    curl_share_cleanup(share);
+    std::shared_lock lock(_namedSessionsMtx);
+
+    auto entry = _namedSessionsData.find(name);
+    return entry != std::end(_namedSessionsData) ? entry->second : nullptr;
 }
 
-Session Factory::CreateSession(const std::string& name, bool trace)
+std::shared_ptr<ProxyHealth> Factory::SelectProxy(const Entry& entry)
 {
-    auto entry = _namedSessionsData.find(name);
-    if (entry == std::end(_namedSessionsData))
-        throw new std::exception("CreateNamedSession can't find name");
+    // No network I/O here, the proxies' health is kept up to date by the ProxyProber.
+    return entry.proxies->Select(entry.options.proxySelection, entry.name);
+}
 
-    auto data = entry->second;
+static long CurlHttpVersion(HttpVersion version)
+{
+    switch (version)
+    {
+        case HttpVersion::Http1_1:
+            return CURL_HTTP_VERSION_1_1;
+        case HttpVersion::Http2:
+            return CURL_HTTP_VERSION_2TLS;
+        case HttpVersion::Http2PriorKnowledge:
+            return CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE;
+        case HttpVersion::Http3:
+            return CURL_HTTP_VERSION_3;
+        default:
+            return CURL_HTTP_VERSION_NONE;
+    }
+}
 
-    Session session;
-    session.SetUrl(data.baseUrl);
-    session._session.SetHeader(data.header);
-    session._session.SetParameters(data.parameters);
+void Factory::ConfigureSession(
+    Session& session, const Entry& data, const std::shared_ptr<ProxyHealth>& proxyHealth, bool trace)
+{
+    session._name    = data.name;
+    session._baseUrl = data.baseUrl;
+    session._preset  = data.preset;
+    session._headerOverlay.clear();
+    session._queryOverlay.clear();
+    session._headerList.reset();
+    session.SetPath(Path());
     session._session.SetRedirect(data.redirect);
     session.SetRetryPolicy(data.retryPolicy);
+    session._proxyHealth  = proxyHealth;
+    session._breaker      = data.breaker;
+    session._retryBudget  = data.retryBudget;
+    session._hedging      = data.hedging;
+    session._metrics      = data.metrics;
+    session._slowRequests = data.slowRequests;
 
-    if (!data.proxies.empty())
+    CURL* curl = session._session.GetCurlHolder()->handle;
+    if (session._resolver != data.resolver)
     {
-        // Find a reachable proxy, if there is none we automatically do direct requests.
-        std::string              proxy;
-        std::vector<std::string> proxies {data.proxies};
-        while (!proxies.empty())
-        {
-            size_t index = 0;
-            if (proxies.size() > 1)
-            {
-                // TODO maybe add config option to always only use the 1st proxy for better connection pooling
-                srand((unsigned)time(nullptr));
-                index = (rand() % proxies.size());
-            }
-            proxy = proxies[index];
-            proxies.erase(proxies.begin() + index);
-
-            if (IsProxyReachable(proxy))
-                break;
-            else
-                proxy.clear();
-        }
+        curl_easy_setopt(curl, CURLOPT_RESOLVE, nullptr);
+        session._resolveList.reset();
+        session._resolveGeneration = 0;
+        session._resolver          = data.resolver;
+    }
 
-        if (!proxy.empty())
-        {
-            // All this URL "parsing" would be much simpler via boost::URL, but maybe too heavy
-            const std::string protocol = data.baseUrl.substr(0, data.baseUrl.find(':'));
+    session._traceSampleRate = data.options.traceSampleRate;
+    session._traceAll        = false;
+    session._traceId         = 0;
 
-            size_t ampPos = proxy.find('@');
-            if (ampPos != std::string::npos)
-            {
-                size_t schemaPos        = proxy.find("://");
-                auto   proxyWithoutAuth = proxy;
-                proxyWithoutAuth.erase(schemaPos + 3, ampPos - schemaPos - 2);
-                auto   auth       = proxy.substr(schemaPos + 3, ampPos - schemaPos - 3);
-                size_t authColPos = auth.find(':');
-                if (authColPos != std::string::npos)
-                {
-                    auto user = auth.substr(0, authColPos);
-                    auto pass = auth.substr(authColPos + 1);
-                    session._session.SetProxyAuth(
-                        cpr::ProxyAuthentication {{protocol, cpr::EncodedAuthentication {user, pass}}});
-                }
-            }
+    if (proxyHealth)
+    {
+        const auto&       proxy = proxyHealth->url;
+        const std::string protocol(data.baseUrl->Scheme());
 
-            session._session.SetProxies({{protocol, proxy}});
-            session.StoreProxy(proxy);
-        }
-        else
+        if (proxy.HasCredentials())
         {
-            session._retryPolicy.directFallbackThreshold = 0;
+            session._session.SetProxyAuth(cpr::ProxyAuthentication {
+                {protocol, cpr::EncodedAuthentication {std::string(proxy.User()), std::string(proxy.Password())}}});
         }
+
+        session._session.SetProxies({{protocol, proxy.Str()}});
+        session.StoreProxy(proxy.Str());
+
+        // libcurl resolves the proxy rather than the target host.
+        if (data.resolver)
+            data.resolver->Watch(proxy.Host(), proxy.Port());
+    }
+    else
+    {
+        // Either there's no proxy at all or none is reachable, we're direct already.
+        session._retryPolicy.directFallbackThreshold = 0;
     }
 
-    CURL* curl = session._session.GetCurlHolder()->handle;
-    curl_easy_setopt(curl, CURLOPT_SHARE, data.share);
+    session._share = data.share;
+    curl_easy_setopt(curl, CURLOPT_SHARE, data.share->Handle());
+
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CurlHttpVersion(data.options.httpVersion));
+    // Waits for a connection able to multiplex instead of opening another one.
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, data.options.httpVersion >= HttpVersion::Http2 ? 1L : 0L);
 
-    // Experiment with other DNS server
-    curl_easy_setopt(curl, CURLOPT_DNS_SERVERS, "1.1.1.1");
+    // Otherwise libcurl's default, the system's resolver configuration.
+    if (!data.options.dns.servers.empty())
+        curl_easy_setopt(curl, CURLOPT_DNS_SERVERS, data.options.dns.servers.c_str());
 
     if (trace)
     {
         session.EnableTrace();
     }
+}
+
+Session Factory::CreateSession(const std::string& name, bool trace)
+{
+    const auto data = FindEntry(name);
+
+    Session session;
+    ConfigureSession(session, *data, SelectProxy(*data), trace);
 
     return session;
 }
 
+MultiSession Factory::CreateMulti(const std::string& name, bool trace)
+{
+    // Fail early on unknown names rather than on the first request.
+    FindEntry(name);
+
+    return MultiSession(name, trace);
+}
+
+Share& Factory::SharedCache(const std::string& name)
+{
+    return *FindEntry(name)->share;
+}
+
+Hedging::Stats Factory::HedgeStats(const std::string& name)
+{
+    const auto entry = FindEntry(name);
+    return entry->hedging ? entry->hedging->GetStats() : Hedging::Stats {};
+}
+
+MetricsSnapshot Factory::SessionMetrics(const std::string& name)
+{
+    const auto entry = FindEntry(name);
+    return entry->metrics ? entry->metrics->Snapshot() : MetricsSnapshot {};
+}
+
+std::string Factory::PrometheusMetrics()
+{
+    decltype(_namedSessionsData) entries;
+    {
+        std::shared_lock lock(_namedSessionsMtx);
+        entries = _namedSessionsData;
+    }
+
+    std::map<std::string, MetricsSnapshot> snapshots;
+    for (const auto& [name, entry] : entries)
+    {
+        if (entry->metrics)
+            snapshots.emplace(name, entry->metrics->Snapshot());
+    }
+    return Metrics::Prometheus(snapshots);
+}
+
+std::vector<SlowRequest> Factory::SlowRequests(const std::string& name)
+{
+    const auto entry = FindEntry(name);
+    return entry->slowRequests ? entry->slowRequests->Snapshot() : std::vector<SlowRequest> {};
+}
+
+ConnectionWarmer::Stats Factory::WarmupStats(const std::string& name)
+{
+    const auto entry = FindEntry(name);
+
+    auto stats         = entry->warmer ? entry->warmer->GetStats() : ConnectionWarmer::Stats {};
+    stats.idleSessions = entry->pool->Idle();
+    return stats;
+}
+
+bool Factory::IsHttp3Supported()
+{
+    return (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP3) != 0;
+}
+
+Scheduler& Factory::RetryScheduler()
+{
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+Tracer& Factory::Tracing()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Factory::SetWorkerThreads(size_t threads)
+{
+    _workerThreads = threads;
+}
+
+WorkerPool& Factory::Workers()
+{
+    static WorkerPool workers(_workerThreads ? _workerThreads : std::thread::hardware_concurrency());
+    return workers;
+}
+
+WorkerPool& Factory::Maintenance()
+{
+    static WorkerPool maintenance(1);
+    return maintenance;
+}
+
+MultiSession& Factory::Streams()
+{
+    // Not bound to a named session, every stream brings its own lease.
+    static MultiSession streams(std::string(), false);
+    return streams;
+}
+
+SessionLease Factory::AcquireSession(const std::string& name)
+{
+    return FindEntry(name)->pool->Acquire();
+}
+
+std::unique_ptr<Session> Factory::NewPooledSession(const std::string& name)
+{
+    const auto data = FindEntry(name);
+
+    auto session = std::make_unique<Session>();
+    ConfigureSession(*session, *data, SelectProxy(*data), false);
+
+    return session;
+}
+
+bool Factory::ResetPooledSession(Session& session)
+{
+    if (session._customized)
+        return false;
+
+    const auto entry = LookupEntry(session._name);
+    if (!entry)
+        return false;
+
+    // Keeps the proxy once selected, which also restores it if it was dropped for a direct fallback.
+    ConfigureSession(session, *entry, session._proxyHealth, false);
+
+    CURL* curl = session._session.GetCurlHolder()->handle;
+    curl_easy_setopt(curl, CURLOPT_VERBOSE, 0L);
+    session._verbose = false;
+    // A streamed request's preparation and progress callback refer to its BodyStream.
+    session._prepper = nullptr;
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, nullptr);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, nullptr);
+    // Set by RangedDownload.
+    curl_easy_setopt(curl, CURLOPT_RANGE, nullptr);
+    // Left attached if the request threw.
+    session.detachUpload();
+
+    return true;
+}
+
 // baseUrl is assumed as an absolute URL as in https://datatracker.ietf.org/doc/html/rfc3986
 void Factory::PrepareSession(const std::string& name, const std::string& baseUrl, const cpr::Header& header,
-    const cpr::Parameters& parameters, const cpr::Redirect& redirect, RetryPolicy retryPolicy)
+    const cpr::Parameters& parameters, const cpr::Redirect& redirect, RetryPolicy retryPolicy,
+    const SessionOptions& options)
 {
     if (!IsAbsoluteUrl(baseUrl))
         throw new std::exception("baseUrl shall be absolute (start with http: or https:)");
@@ -472,60 +852,56 @@ void Factory::PrepareSession(const std::string& name, const std::string& baseUrl
     entry.name = name;
 
     if (baseUrl.back() == '/')
-        entry.baseUrl = baseUrl;
+        entry.baseUrl = std::make_shared<const ParsedUrl>(baseUrl);
     else
-        entry.baseUrl = baseUrl + '/';
+        entry.baseUrl = std::make_shared<const ParsedUrl>(baseUrl + '/');
 
-    // TODO maybe resolve here and also maybe perform connectivity tests
+    // TODO maybe perform connectivity tests
 
-    entry.header      = header;
-    entry.parameters  = parameters;
+    entry.preset      = std::make_shared<const RequestPreset>(header, parameters);
     entry.redirect    = redirect;
     entry.retryPolicy = retryPolicy;
     if (entry.retryPolicy.directFallbackThreshold >= entry.retryPolicy.maxRetries && entry.retryPolicy.maxRetries > 0)
         entry.retryPolicy.directFallbackThreshold = entry.retryPolicy.maxRetries - 1;
-
-
+    entry.options = options;
+    if (entry.options.httpVersion == HttpVersion::Http3 && !IsHttp3Supported())
+        entry.options.httpVersion = HttpVersion::Http2;
+
+    // Discovery is only started here, the first session created waits for it.
+    entry.proxies = std::make_shared<ProxyGroup>(entry.baseUrl->Str());
+    if (options.breaker.failureRatio > 0)
+        entry.breaker = std::make_shared<CircuitBreaker>(options.breaker);
+    if (options.retryBudget.ratio > 0)
+        entry.retryBudget = std::make_shared<RetryBudget>(options.retryBudget);
+    if (options.hedge.enabled)
+        entry.hedging = std::make_shared<Hedging>(options.hedge);
+    if (options.metrics)
+        entry.metrics = std::make_shared<Metrics>();
+    if (options.slowRequests.threshold.count() > 0)
+        entry.slowRequests = std::make_shared<SlowRequestLog>(options.slowRequests);
+    if (options.dns.preResolve)
     {
-        std::lock_guard<std::mutex> lock(_proxyFactoryMtx);
-        if (!_proxyFactory)
-            _proxyFactory = px_proxy_factory_new();
-
-        // TODO This is blocking thus maybe call in another thread and wait on the first CreateSession or first actual
-        // request.
-        auto   proxies = px_proxy_factory_get_proxies(_proxyFactory, baseUrl.c_str());
-        char** proxy   = proxies;
-        while (*proxy)
-        {
-            // Usually one of:
-            // direct://
-            // http://[username:password@]proxy:port
-            if (IsAbsoluteUrl(*proxy))
-            {
-                entry.proxies.push_back(*proxy);
-            }
-            ++proxy;
-        }
-
-        px_proxy_factory_free_proxies(proxies);
+        // Resolved in the background, so the first requests find the addresses ready.
+        entry.resolver = std::make_shared<HostResolver>(options.dns);
+        entry.resolver->Watch(entry.baseUrl->Host(), entry.baseUrl->Port());
     }
 
-    _namedSessionsData[name] = entry;
-}
+    // Pooled sessions look up the stored entry. The pool is filled on the first lease, which waits for the proxy
+    // discovery anyway.
+    entry.pool = std::make_shared<SessionPool>(
+        [name] { return NewPooledSession(name); }, &Factory::ResetPooledSession, entry.options.pool);
+    if (options.warmup.connections > 0)
+        entry.warmer = std::make_shared<ConnectionWarmer>(name, options.warmup);
 
-bool Factory::IsProxyReachable(const std::string& url)
-{
-    auto r = cpr::Head(cpr::Url(url), cpr::Timeout(1s));
-    // Retry for more resilience.
-    if (!r.status_code)
+    auto stored = std::make_shared<const Entry>(std::move(entry));
     {
-        std::this_thread::sleep_for(100ms);
-        r = cpr::Head(cpr::Url(url), cpr::Timeout(1s));
+        std::unique_lock lock(_namedSessionsMtx);
+        _namedSessionsData[name] = stored;
     }
 
-    // if there's any status_code it means the server somehow replied, most probably with 400 Bad Request, as HEAD may
-    // not be supported. Usually when a server isn't reachable we get some r.error
-    return r.status_code != 0;
+    // Its rounds lease sessions of the stored entry.
+    if (stored->warmer)
+        stored->warmer->Start();
 }
 
 }
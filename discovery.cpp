@@ -0,0 +1,107 @@
+#include "include/cprex/cprex.h"
+#include "include/cprex/discovery.h"
+using namespace std::chrono_literals;
+
+namespace cprex
+{
+std::mutex                                    ProxyDiscovery::_cacheMtx;
+std::map<std::string, ProxyDiscovery::Cached> ProxyDiscovery::_cache;
+std::chrono::seconds                          ProxyDiscovery::_ttl = 5min;
+
+pxProxyFactory* ProxyDiscovery::_proxyFactory = nullptr;
+std::mutex      ProxyDiscovery::_proxyFactoryMtx;
+
+std::shared_future<ProxyDiscovery::Proxies> ProxyDiscovery::Lookup(const std::string& url, uint64_t* generation)
+{
+    const auto key = Key(url);
+    const auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(_cacheMtx);
+
+    auto cached = _cache.find(key);
+    if (cached == std::end(_cache))
+    {
+        auto& entry   = _cache[key];
+        entry.proxies = Start(url);
+        entry.expires = now + _ttl;
+        if (generation)
+            *generation = entry.generation;
+        return entry.proxies;
+    }
+
+    auto& entry = cached->second;
+    if (entry.refresh.valid() && entry.refresh.wait_for(0s) == std::future_status::ready)
+    {
+        entry.proxies = std::move(entry.refresh);
+        entry.refresh = {};
+        entry.expires = now + _ttl;
+        ++entry.generation;
+    }
+    else if (!entry.refresh.valid() && now >= entry.expires)
+    {
+        entry.refresh = Start(url);
+    }
+
+    if (generation)
+        *generation = entry.generation;
+    return entry.proxies;
+}
+
+void ProxyDiscovery::SetTtl(std::chrono::seconds ttl)
+{
+    std::lock_guard<std::mutex> lock(_cacheMtx);
+    _ttl = ttl;
+}
+
+std::string ProxyDiscovery::Key(const std::string& url)
+{
+    // scheme://[user:pass@]host[:port]/... -> scheme://host[:port]
+    size_t schemaPos = url.find("://");
+    if (schemaPos == std::string::npos)
+        return url;
+
+    size_t hostPos = schemaPos + 3;
+    size_t hostEnd = url.find_first_of("/?#", hostPos);
+    if (hostEnd == std::string::npos)
+        hostEnd = url.size();
+
+    size_t ampPos = url.rfind('@', hostEnd);
+    if (ampPos != std::string::npos && ampPos >= hostPos)
+        hostPos = ampPos + 1;
+
+    return url.substr(0, schemaPos + 3) + url.substr(hostPos, hostEnd - hostPos);
+}
+
+std::shared_future<ProxyDiscovery::Proxies> ProxyDiscovery::Start(const std::string& url)
+{
+    return std::async(std::launch::async, &ProxyDiscovery::Query, url).share();
+}
+
+ProxyDiscovery::Proxies ProxyDiscovery::Query(const std::string& url)
+{
+    Proxies result;
+
+    // Lookups of different hosts still run one at a time, but only in the background.
+    std::lock_guard<std::mutex> lock(_proxyFactoryMtx);
+    if (!_proxyFactory)
+        _proxyFactory = px_proxy_factory_new();
+
+    auto   proxies = px_proxy_factory_get_proxies(_proxyFactory, url.c_str());
+    char** proxy   = proxies;
+    while (*proxy)
+    {
+        // Usually one of:
+        // direct://
+        // http://[username:password@]proxy:port
+        if (IsAbsoluteUrl(*proxy))
+        {
+            result.push_back(*proxy);
+        }
+        ++proxy;
+    }
+
+    px_proxy_factory_free_proxies(proxies);
+
+    return result;
+}
+}
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cerrno>
+
+#include "include/cprex/file.h"
+
+#ifdef _WIN32
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace cprex
+{
+#ifdef _WIN32
+File::File(const cpr::fs::path& path, Access access)
+{
+    if (access == Access::Read)
+    {
+        _handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (_handle == INVALID_HANDLE_VALUE)
+            throw new std::exception("Can't open upload file");
+        return;
+    }
+
+    // Mappings need read access as well.
+    _handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_handle == INVALID_HANDLE_VALUE)
+        throw new std::exception("Can't create download file");
+}
+
+File::~File()
+{
+    CloseHandle(_handle);
+}
+
+void File::Preallocate(uint64_t size)
+{
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFileInformationByHandle(_handle, FileAllocationInfo, &info, sizeof(info)))
+        throw new std::exception("Can't preallocate download file");
+}
+
+void File::Resize(uint64_t size)
+{
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFileInformationByHandle(_handle, FileEndOfFileInfo, &info, sizeof(info)))
+        throw new std::exception("Can't resize download file");
+}
+
+void File::WriteAt(uint64_t offset, const char* data, size_t size)
+{
+    while (size)
+    {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset     = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD written = 0;
+        DWORD chunk   = static_cast<DWORD>(std::min<size_t>(size, MAXDWORD));
+        if (!WriteFile(_handle, data, chunk, &written, &overlapped))
+            throw new std::exception("Can't write download file");
+
+        offset += written;
+        data += written;
+        size -= written;
+    }
+}
+
+size_t File::ReadAt(uint64_t offset, char* data, size_t size)
+{
+    size_t total = 0;
+    while (total < size)
+    {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset     = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD read  = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size - total, MAXDWORD));
+        if (!ReadFile(_handle, data + total, chunk, &read, &overlapped))
+        {
+            if (GetLastError() == ERROR_HANDLE_EOF)
+                break;
+            throw new std::exception("Can't read upload file");
+        }
+        if (!read)
+            break;
+
+        offset += read;
+        total += read;
+    }
+    return total;
+}
+
+uint64_t File::Size() const
+{
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_handle, &size))
+        throw new std::exception("Can't get file size");
+    return static_cast<uint64_t>(size.QuadPart);
+}
+
+void File::Sync()
+{
+    FlushFileBuffers(_handle);
+}
+
+size_t File::MapAlignment()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+char* File::Map(uint64_t offset, size_t size)
+{
+    const uint64_t end     = offset + size;
+    HANDLE         mapping = CreateFileMappingW(
+        _handle, nullptr, PAGE_READWRITE, static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), nullptr);
+    if (!mapping)
+        throw new std::exception("Can't map download file");
+
+    // The view keeps the mapping alive.
+    void* view = MapViewOfFile(
+        mapping, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), size);
+    CloseHandle(mapping);
+    if (!view)
+        throw new std::exception("Can't map download file");
+
+    return static_cast<char*>(view);
+}
+
+void File::Unmap(char* data, size_t)
+{
+    UnmapViewOfFile(data);
+}
+
+void File::FlushMapping(char* data, size_t size)
+{
+    FlushViewOfFile(data, size);
+}
+#else
+File::File(const cpr::fs::path& path, Access access)
+{
+    if (access == Access::Read)
+    {
+        _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_fd < 0)
+            throw new std::exception("Can't open upload file");
+#    ifdef __linux__
+        posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#    endif
+        return;
+    }
+
+    // Mappings need read access as well.
+    _fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (_fd < 0)
+        throw new std::exception("Can't create download file");
+}
+
+File::~File()
+{
+    close(_fd);
+}
+
+void File::Preallocate(uint64_t size)
+{
+#    ifdef __linux__
+    if (posix_fallocate(_fd, 0, static_cast<off_t>(size)) == 0)
+        return;
+#    endif
+    // At least sets the size where the file system can't allocate up front.
+    Resize(size);
+}
+
+void File::Resize(uint64_t size)
+{
+    if (ftruncate(_fd, static_cast<off_t>(size)) != 0)
+        throw new std::exception("Can't resize download file");
+}
+
+void File::WriteAt(uint64_t offset, const char* data, size_t size)
+{
+    while (size)
+    {
+        ssize_t written = pwrite(_fd, data, size, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw new std::exception("Can't write download file");
+        }
+
+        offset += written;
+        data += written;
+        size -= written;
+    }
+}
+
+size_t File::ReadAt(uint64_t offset, char* data, size_t size)
+{
+    size_t total = 0;
+    while (total < size)
+    {
+        ssize_t read = pread(_fd, data + total, size - total, static_cast<off_t>(offset));
+        if (read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw new std::exception("Can't read upload file");
+        }
+        if (!read)
+            break;
+
+        offset += read;
+        total += read;
+    }
+    return total;
+}
+
+uint64_t File::Size() const
+{
+    struct stat st;
+    if (fstat(_fd, &st) != 0)
+        throw new std::exception("Can't get file size");
+    return static_cast<uint64_t>(st.st_size);
+}
+
+void File::Sync()
+{
+    fsync(_fd);
+}
+
+size_t File::MapAlignment()
+{
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+char* File::Map(uint64_t offset, size_t size)
+{
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, static_cast<off_t>(offset));
+    if (data == MAP_FAILED)
+        throw new std::exception("Can't map download file");
+
+    return static_cast<char*>(data);
+}
+
+void File::Unmap(char* data, size_t size)
+{
+    munmap(data, size);
+}
+
+void File::FlushMapping(char* data, size_t size)
+{
+    msync(data, size, MS_SYNC);
+}
+#endif
+}
@@ -0,0 +1,433 @@
+#include "include/cprex/cprex.h"
+#include "include/cprex/health.h"
+#include "include/cprex/random.h"
+#include <algorithm>
+#include <bit>
+using namespace std::chrono_literals;
+
+namespace cprex
+{
+// After this many failures in a row a proxy counts as unreachable until a probe succeeds again.
+static constexpr uint32_t MaxConsecutiveFailures = 3;
+// Milliseconds between asking the discovery cache whether a group's proxies were refreshed.
+static constexpr int64_t RecheckInterval = 1000;
+
+void ProxyHealth::RecordProbe(bool success, std::chrono::microseconds latency)
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    lastProbe      = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+    if (!success)
+    {
+        ++consecutiveFailures;
+        reachable = false;
+        return;
+    }
+
+    consecutiveFailures = 0;
+    reachable           = true;
+
+    // alpha = 1/4, good enough to smooth out single slow probes.
+    const auto sample = static_cast<uint32_t>(std::min<int64_t>(latency.count(), UINT32_MAX));
+    const auto ewma   = latencyEwma.load();
+    latencyEwma       = ewma ? ewma - ewma / 4 + sample / 4 : sample;
+}
+
+void ProxyHealth::RecordRequest(bool success)
+{
+    // Avoid writing the shared cache line on the common success path.
+    if (success)
+    {
+        if (consecutiveFailures.load(std::memory_order_relaxed))
+            consecutiveFailures.store(0, std::memory_order_relaxed);
+    }
+    else
+    {
+        consecutiveFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+ProxyGroup::ProxyGroup(const std::string& url) : _url(url)
+{
+    _discovery = ProxyDiscovery::Lookup(url, &_generation);
+}
+
+std::shared_ptr<const ProxyGroup::ProxyList> ProxyGroup::Proxies()
+{
+    auto current = ranked();
+    return std::shared_ptr<const ProxyList>(current, &current->proxies);
+}
+
+std::shared_ptr<ProxyGroup::Ranked> ProxyGroup::ranked()
+{
+    std::call_once(_resolved, [this] { use(_discovery.get()); });
+    refresh();
+    return _ranked.load();
+}
+
+void ProxyGroup::refresh()
+{
+    const int64_t now =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    int64_t recheck = _recheck.load(std::memory_order_relaxed);
+    if (now < recheck ||
+        !_recheck.compare_exchange_strong(recheck, now + RecheckInterval, std::memory_order_relaxed))
+        return;
+
+    std::unique_lock<std::mutex> lock(_refreshMtx, std::try_to_lock);
+    if (!lock)
+        return;
+
+    // Doesn't block: starts a refresh once the TTL passed and hands out its result once that is ready.
+    uint64_t generation = 0;
+    auto     discovery  = ProxyDiscovery::Lookup(_url, &generation);
+    if (generation == _generation)
+        return;
+
+    _generation = generation;
+    use(discovery.get());
+}
+
+void ProxyGroup::use(const std::vector<std::string>& proxies)
+{
+    auto next = std::make_shared<Ranked>();
+    for (const auto& proxy : proxies)
+        next->proxies.push_back(ProxyProber::Health(proxy));
+
+    rank(*next);
+    _ranked.store(next);
+    if (!next->proxies.empty())
+        ProxyProber::Watch(shared_from_this());
+}
+
+std::shared_ptr<ProxyHealth> ProxyGroup::Select(ProxySelection selection, const std::string& name)
+{
+    const auto  current = ranked();
+    const auto& proxies = current->proxies;
+
+    switch (selection)
+    {
+        case ProxySelection::Healthiest:
+        {
+            int best = current->best.load(std::memory_order_relaxed);
+            return best < 0 ? nullptr : proxies[best];
+        }
+        case ProxySelection::StickyFirst:
+        {
+            int first = current->first.load(std::memory_order_relaxed);
+            return first < 0 ? nullptr : proxies[first];
+        }
+        case ProxySelection::ConsistentHashByName:
+            return SelectByHash(*current, std::hash<std::string> {}(name));
+        case ProxySelection::ConsistentHashByThread:
+            return SelectByHash(*current, std::hash<std::thread::id> {}(std::this_thread::get_id()));
+        case ProxySelection::LatencyWeighted:
+            return SelectByLatency(*current);
+        case ProxySelection::RoundRobin:
+        {
+            const uint64_t usable = current->usable.load(std::memory_order_relaxed);
+            if (!usable)
+                return nullptr;
+
+            // Skip to the n-th set bit.
+            uint64_t n = _next.fetch_add(1, std::memory_order_relaxed) % std::popcount(usable);
+            for (size_t i = 0; i < proxies.size() && i < 64; ++i)
+            {
+                if ((usable & (1ull << i)) && !n--)
+                    return proxies[i];
+            }
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<ProxyHealth> ProxyGroup::SelectByHash(const Ranked& ranked, uint64_t key)
+{
+    // Rendezvous hashing: only the keys of a proxy which becomes unreachable move elsewhere.
+    const auto&    proxies = ranked.proxies;
+    const uint64_t usable  = ranked.usable.load(std::memory_order_relaxed);
+
+    std::shared_ptr<ProxyHealth> selected;
+    uint64_t                     highest = 0;
+    for (size_t i = 0; i < proxies.size() && i < 64; ++i)
+    {
+        if (!(usable & (1ull << i)))
+            continue;
+
+        const uint64_t weight = Random::Mix(key ^ std::hash<std::string> {}(proxies[i]->url.Str()));
+        if (!selected || weight > highest)
+        {
+            selected = proxies[i];
+            highest  = weight;
+        }
+    }
+    return selected;
+}
+
+std::shared_ptr<ProxyHealth> ProxyGroup::SelectByLatency(const Ranked& ranked)
+{
+    const auto&    proxies = ranked.proxies;
+    const uint64_t usable  = ranked.usable.load(std::memory_order_relaxed);
+
+    // Proxies not probed yet get the weight of a 100ms latency.
+    auto weight = [](const ProxyHealth& proxy) {
+        const uint32_t latency = proxy.latencyEwma.load(std::memory_order_relaxed);
+        return 1.0 / (latency ? latency : 100'000);
+    };
+
+    double total = 0;
+    for (size_t i = 0; i < proxies.size() && i < 64; ++i)
+    {
+        if (usable & (1ull << i))
+            total += weight(*proxies[i]);
+    }
+
+    double pick = Random::NextDouble() * total;
+    for (size_t i = 0; i < proxies.size() && i < 64; ++i)
+    {
+        if (!(usable & (1ull << i)))
+            continue;
+
+        pick -= weight(*proxies[i]);
+        if (pick < 0)
+            return proxies[i];
+    }
+
+    // Rounding, or none is reachable.
+    int best = ranked.best.load(std::memory_order_relaxed);
+    return best < 0 ? nullptr : proxies[best];
+}
+
+void ProxyGroup::Rank()
+{
+    if (auto current = _ranked.load())
+        rank(*current);
+}
+
+void ProxyGroup::rank(Ranked& ranked)
+{
+    // Prefers reachable ones, then the least failures in a row, then the lowest latency. Ties keep the order of the
+    // discovery, which is the order of preference the proxy configuration gave.
+    const auto& proxies = ranked.proxies;
+    int         best    = -1;
+    uint64_t    usable  = 0;
+    for (int i = 0; i < static_cast<int>(proxies.size()); ++i)
+    {
+        const auto& candidate = *proxies[i];
+        if (!candidate.reachable || candidate.consecutiveFailures >= MaxConsecutiveFailures)
+            continue;
+
+        if (i < 64)
+            usable |= 1ull << i;
+
+        if (best < 0)
+        {
+            best         = i;
+            ranked.first = i;
+            continue;
+        }
+
+        const auto& current = *proxies[best];
+        if (candidate.consecutiveFailures != current.consecutiveFailures)
+        {
+            if (candidate.consecutiveFailures < current.consecutiveFailures)
+                best = i;
+        }
+        else if (candidate.latencyEwma && (!current.latencyEwma || candidate.latencyEwma < current.latencyEwma))
+        {
+            best = i;
+        }
+    }
+    if (best < 0)
+        ranked.first = -1;
+    ranked.best   = best;
+    ranked.usable = usable;
+}
+
+std::mutex                              ProxyProber::_mtx;
+std::vector<std::weak_ptr<ProxyHealth>> ProxyProber::_proxies;
+std::vector<std::weak_ptr<ProxyGroup>>  ProxyProber::_groups;
+std::chrono::seconds                    ProxyProber::_interval  = 30s;
+bool                                    ProxyProber::_scheduled = false;
+
+void ProxyProber::SetInterval(std::chrono::seconds interval)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    _interval = interval;
+}
+
+std::shared_ptr<ProxyHealth> ProxyProber::Health(const std::string& proxyUrl)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    for (const auto& weak : _proxies)
+    {
+        auto health = weak.lock();
+        if (health && health->url.Str() == proxyUrl)
+            return health;
+    }
+
+    auto health = std::make_shared<ProxyHealth>(proxyUrl);
+    _proxies.push_back(health);
+    return health;
+}
+
+void ProxyProber::Watch(const std::shared_ptr<ProxyGroup>& group)
+{
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        // Groups watch again whenever their discovery was refreshed.
+        if (std::none_of(_groups.begin(), _groups.end(), [&group](const auto& weak) { return weak.lock() == group; }))
+            _groups.push_back(group);
+        schedule   = !_scheduled;
+        _scheduled = true;
+    }
+    if (schedule)
+        Schedule(0ms);
+}
+
+void ProxyProber::Schedule(std::chrono::milliseconds delay)
+{
+    // The scheduler thread shall not block, the probes run on the maintenance thread rather than a worker serving
+    // requests.
+    Factory::RetryScheduler().Schedule(delay, [] { Factory::Maintenance().Submit(&ProxyProber::ProbeRound); });
+}
+
+void ProxyProber::ProbeRound()
+{
+    std::vector<std::shared_ptr<ProxyHealth>> proxies;
+    std::vector<std::shared_ptr<ProxyGroup>>  groups;
+    std::chrono::seconds                      interval;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        std::erase_if(_proxies, [](const auto& weak) { return weak.expired(); });
+        std::erase_if(_groups, [](const auto& weak) { return weak.expired(); });
+
+        for (const auto& weak : _proxies)
+            if (auto health = weak.lock())
+                proxies.push_back(std::move(health));
+        for (const auto& weak : _groups)
+            if (auto group = weak.lock())
+                groups.push_back(std::move(group));
+
+        interval = _interval;
+        if (proxies.empty())
+        {
+            // Started again by the next Watch().
+            _scheduled = false;
+            return;
+        }
+    }
+
+    ProbeAll(proxies);
+
+    for (const auto& group : groups)
+        group->Rank();
+
+    Schedule(interval);
+}
+
+void ProxyProber::ProbeAll(const std::vector<std::shared_ptr<ProxyHealth>>& proxies)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // A HEAD request to every proxy, all at once on a private multi handle. One without response is retried once, so
+    // a round takes at most twice ProbeTimeout plus ProbeRetryDelay no matter how many proxies are dead.
+    static constexpr auto ProbeTimeout    = 1000ms;
+    static constexpr auto ProbeRetryDelay = 100ms;
+
+    struct Probe
+    {
+        std::shared_ptr<ProxyHealth> health;
+        CURL*                        curl = nullptr;
+        Clock::time_point            start;
+        // Set while waiting for the retry.
+        std::optional<Clock::time_point> retryAt;
+        bool                             retried = false;
+        bool                             done    = false;
+    };
+
+    CURLM*             multi = curl_multi_init();
+    std::vector<Probe> probes(proxies.size());
+    const auto         start = Clock::now();
+    for (size_t i = 0; i < proxies.size(); ++i)
+    {
+        auto& probe  = probes[i];
+        probe.health = proxies[i];
+        probe.curl   = curl_easy_init();
+        probe.start  = start;
+        curl_easy_setopt(probe.curl, CURLOPT_URL, probe.health->url.Str().c_str());
+        curl_easy_setopt(probe.curl, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(probe.curl, CURLOPT_TIMEOUT_MS, static_cast<long>(ProbeTimeout.count()));
+        curl_easy_setopt(probe.curl, CURLOPT_PRIVATE, &probe);
+        curl_multi_add_handle(multi, probe.curl);
+    }
+
+    auto finish = [](Probe& probe, bool reachable) {
+        probe.done = true;
+        probe.health->RecordProbe(
+            reachable, std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - probe.start));
+    };
+
+    const auto deadline = start + 2 * ProbeTimeout + ProbeRetryDelay;
+    size_t     pending  = probes.size();
+    while (pending && Clock::now() < deadline)
+    {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int      queued;
+        CURLMsg* msg;
+        while ((msg = curl_multi_info_read(multi, &queued)))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            Probe* probe = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &probe);
+            long status_code = 0;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &status_code);
+            curl_multi_remove_handle(multi, msg->easy_handle);
+
+            // If there's any status_code the proxy somehow replied, most probably with 400 Bad Request, as HEAD may
+            // not be supported. Usually an unreachable one gives no response at all.
+            if (!status_code && !probe->retried)
+            {
+                probe->retried = true;
+                probe->retryAt = Clock::now() + ProbeRetryDelay;
+                continue;
+            }
+            finish(*probe, status_code != 0);
+            --pending;
+        }
+
+        for (auto& probe : probes)
+        {
+            if (probe.retryAt && Clock::now() >= *probe.retryAt)
+            {
+                probe.retryAt.reset();
+                curl_multi_add_handle(multi, probe.curl);
+            }
+        }
+
+        curl_multi_poll(multi, nullptr, 0, static_cast<int>(ProbeRetryDelay.count()), nullptr);
+    }
+
+    // Whatever didn't answer by now counts as unreachable.
+    for (auto& probe : probes)
+    {
+        if (!probe.done)
+        {
+            if (!probe.retryAt)
+                curl_multi_remove_handle(multi, probe.curl);
+            finish(probe, false);
+        }
+        curl_easy_cleanup(probe.curl);
+    }
+    curl_multi_cleanup(multi);
+}
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <vector>
+
+#include "include/cprex/hedge.h"
+
+namespace cprex
+{
+Hedging::Hedging(const HedgeOptions& options) : _options(options), _budget(options.budget)
+{
+}
+
+std::optional<std::chrono::microseconds> Hedging::Begin()
+{
+    _requests.fetch_add(1, std::memory_order_relaxed);
+    _budget.Deposit();
+
+    if (_options.delay.count())
+        return _options.delay;
+
+    const uint32_t percentile = _percentile.load(std::memory_order_relaxed);
+    if (!percentile)
+        return std::nullopt;
+    return std::chrono::microseconds(percentile);
+}
+
+bool Hedging::Fire()
+{
+    if (!_budget.TryWithdraw())
+    {
+        _denied.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    _fired.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void Hedging::Won()
+{
+    _won.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Hedging::RecordLatency(std::chrono::microseconds latency)
+{
+    const uint64_t n = _recorded.fetch_add(1, std::memory_order_relaxed);
+    _latencies[n % Samples].store(
+        static_cast<uint32_t>(std::min<int64_t>(latency.count(), UINT32_MAX)), std::memory_order_relaxed);
+
+    if (n + 1 >= Samples && (n + 1) % (Samples / 4) == 0)
+        recalculate();
+}
+
+Hedging::Stats Hedging::GetStats() const
+{
+    return {_requests.load(), _fired.load(), _won.load(), _denied.load()};
+}
+
+void Hedging::recalculate()
+{
+    std::vector<uint32_t> latencies(Samples);
+    for (size_t i = 0; i < Samples; ++i)
+        latencies[i] = _latencies[i].load(std::memory_order_relaxed);
+
+    const auto rank = static_cast<ptrdiff_t>(std::clamp(_options.percentile, 0.0, 1.0) * (Samples - 1));
+    const auto nth  = latencies.begin() + rank;
+    std::nth_element(latencies.begin(), nth, latencies.end());
+    _percentile.store(std::max<uint32_t>(*nth, 1), std::memory_order_relaxed);
+}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <chrono>
+#include <functional>
+
+namespace cprex
+{
+// Delay to wait after a failed request attempt, attempt counting from 0.
+using BackofPolicy = std::function<std::chrono::milliseconds(size_t attempt)>;
+
+// Built-in backoff policies. All take the median delay after the first attempt and cap every delay at maxDelay.
+// The jittered ones spread the retries of many clients over time, so they don't hit a recovering server all at once:
+// https://aws.amazon.com/blogs/architecture/exponential-backoff-and-jitter/
+// https://www.pollydocs.org/strategies/retry
+namespace Backoff
+{
+// medianFirstDelay * 2^attempt, no jitter.
+BackofPolicy CappedExponential(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay);
+
+// Uniformly random in [0, base * 2^attempt] with base = 2 * medianFirstDelay.
+BackofPolicy FullJitter(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay);
+
+// Half of base * 2^attempt plus a uniformly random other half, base = 4/3 * medianFirstDelay.
+BackofPolicy EqualJitter(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay);
+
+// Polly's decorrelated jitter V2, which grows exponentially without the spikes and gaps of the others:
+// https://github.com/Polly-Contrib/Polly.Contrib.WaitAndRetry/blob/master/src/Polly.Contrib.WaitAndRetry/Backoff.DecorrelatedJitterV2.cs
+// Polly carries the random part of the previous delay over to the next one. The policy here only gets the attempt
+// number, so it draws that part anew, which gives every single delay the same distribution as Polly's. As in Polly
+// the first median comes out at about 0.9 * medianFirstDelay, later ones double with every attempt.
+BackofPolicy DecorrelatedJitterV2(std::chrono::milliseconds medianFirstDelay, std::chrono::milliseconds maxDelay);
+}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace cprex
+{
+// Like Polly's circuit breaker: https://www.pollydocs.org/strategies/circuit-breaker
+struct BreakerOptions
+{
+    // Failed share of the requests within samplingDuration at which the circuit opens, e.g. 0.1. The default 0
+    // disables the breaker.
+    double failureRatio = 0;
+
+    // Requests needed within samplingDuration before the failure ratio counts at all.
+    size_t minimumThroughput = 100;
+
+    std::chrono::seconds samplingDuration = std::chrono::seconds(30);
+
+    // Time an open circuit rejects all requests before it lets probe requests through.
+    std::chrono::seconds breakDuration = std::chrono::seconds(5);
+
+    // Requests let through at the same time while half open.
+    size_t halfOpenProbes = 1;
+
+    // Time after which half-open probes that didn't report back are given up, so further ones are let through.
+    std::chrono::seconds probeTimeout = std::chrono::seconds(30);
+};
+
+// Shared by all sessions of a named config. Every request attempt asks Allow() before it is performed and reports its
+// outcome via Record(). Allow() is lock-free, so an open circuit fails requests within microseconds.
+class CircuitBreaker final
+{
+public:
+    enum class State
+    {
+        Closed,
+        Open,
+        HalfOpen,
+    };
+
+    explicit CircuitBreaker(const BreakerOptions& options);
+
+    CircuitBreaker(const CircuitBreaker&)            = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    // Whether the request may be performed. If so, its outcome shall be passed to Record(), or Abandon() called if
+    // it won't finish, e.g. as it was cancelled.
+    bool Allow();
+    void Record(bool success);
+    // Gives back the half-open probe slot an allowed request may hold.
+    void Abandon();
+
+    State GetState() const
+    {
+        return _state;
+    }
+
+    // Connection errors, 408, 429 and 5xx count as failures, other responses mean the server is alive.
+    static bool IsFailure(int curlError, long statusCode);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t Buckets = 10;
+
+    // Counts of one samplingDuration/Buckets slice of time.
+    struct Bucket
+    {
+        std::atomic<int64_t>  slot      = -1;
+        std::atomic<uint32_t> successes = 0;
+        std::atomic<uint32_t> failures  = 0;
+    };
+
+    int64_t now() const;
+    Bucket& bucket(int64_t slot);
+    void    open(int64_t now);
+    void    close();
+
+    const BreakerOptions _options;
+    const int64_t        _slotWidth;
+
+    std::atomic<State>   _state     = State::Closed;
+    std::atomic<int64_t> _openUntil = 0;
+    std::atomic<size_t>  _probes    = 0;
+    // When the current set of half-open probes started.
+    std::atomic<int64_t> _probesSince = 0;
+
+    // Only taken when the sampling window moves on to a new slot.
+    std::mutex                   _rollMtx;
+    std::array<Bucket, Buckets> _buckets;
+};
+}
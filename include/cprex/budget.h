@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+namespace cprex
+{
+// Like Finagle's retry budget: https://twitter.github.io/finagle/guide/Clients.html#retries
+struct RetryBudgetOptions
+{
+    // Retries earned by every successful request, e.g. 0.2. The default 0 disables the budget.
+    double ratio = 0;
+
+    // Retries earned over time in any case, so that rarely used sessions are still able to retry.
+    double minRetriesPerSecond = 10;
+
+    // Most retries that can be saved up, also the initial balance.
+    double maxBalance = 100;
+};
+
+// Token bucket shared by all sessions of a named config: every retry costs one token. Thus all retries together
+// stay within ratio of the successful requests, no matter how many retries a single request's RetryPolicy allows.
+// Lock-free, a success costs a single atomic add.
+class RetryBudget final
+{
+public:
+    explicit RetryBudget(const RetryBudgetOptions& options);
+
+    RetryBudget(const RetryBudget&)            = delete;
+    RetryBudget& operator=(const RetryBudget&) = delete;
+
+    void Deposit();
+    // Takes a token for a retry, false if there is none.
+    bool TryWithdraw();
+
+    double Balance() const
+    {
+        return static_cast<double>(_balance.load(std::memory_order_relaxed)) / Scale;
+    }
+
+private:
+    // Tokens are counted in thousandths to be able to deposit fractions.
+    static constexpr int64_t Scale = 1000;
+
+    int64_t now() const;
+    void    refill();
+
+    const int64_t _deposit;
+    const double  _perMillisecond;
+    const int64_t _max;
+
+    std::atomic<int64_t> _balance;
+    std::atomic<int64_t> _lastRefill;
+};
+}
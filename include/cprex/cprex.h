@@ -2,14 +2,39 @@
 #include <chrono>
 #include <thread>
 #include <cmath>
+#include <future>
+#include <optional>
+#include <shared_mutex>
+#include <tuple>
 #include <variant>
 
 #include <cpr/cpr.h> // https://github.com/libcpr/cpr
-#include "proxy.h"   // https://github.com/libproxy/libproxy
+
+#include "backoff.h"
+#include "breaker.h"
+#include "budget.h"
+#include "discovery.h"
+#include "health.h"
+#include "hedge.h"
+#include "metrics.h"
+#include "pool.h"
+#include "preset.h"
+#include "ranged.h"
+#include "resolver.h"
+#include "response.h"
+#include "scheduler.h"
+#include "share.h"
+#include "sink.h"
+#include "stream.h"
+#include "tracer.h"
+#include "upload.h"
+#include "url.h"
+#include "warmer.h"
+#include "workers.h"
 
 namespace cprex
 {
-static inline bool IsAbsoluteUrl(const std::string& url)
+static inline bool IsAbsoluteUrl(std::string_view url)
 {
     // This of course is not a full check but only a pragmatic approach.
     // It would require a full URL parser like boost::URL.
@@ -17,6 +42,8 @@ static inline bool IsAbsoluteUrl(const std::string& url)
 }
 
 std::string AppendUrls(const std::string& baseUrl, const std::string& otherUrl);
+// Like above but written into url, whose capacity is reused.
+void AppendUrls(std::string& url, std::string_view baseUrl, std::string_view otherUrl);
 
 namespace StatusCode
 {
@@ -26,7 +53,6 @@ bool CanRetry(long statusCode);
 
 // Do more resilience like in Polly: https://github.com/App-vNext/Polly
 // https://www.pollydocs.org/strategies/retry
-using BackofPolicy = std::function<std::chrono::milliseconds(size_t attempt)>;
 struct RetryPolicy
 {
     // Set maxRetries=0 to not retry at all and thus do only a single request attempt.
@@ -38,11 +64,72 @@ struct RetryPolicy
     // =0 to never fallback to direct.
     size_t directFallbackThreshold;
 
-    // AMount of milliseconds to wait after every request attempt.
+    // AMount of milliseconds to wait after every request attempt, see the Backoff namespace for built-in ones.
     BackofPolicy backofPolicy;
 };
+// 100ms * 2^attempt, capped at 10min.
 extern const BackofPolicy DefaultExponentialBackofPolicy;
-extern const RetryPolicy  DefaultRetryPolicy;
+// Decorrelated jitter with a median first delay of 100ms, capped at 10min.
+extern const BackofPolicy DefaultJitterBackofPolicy;
+// 5 retries with DefaultJitterBackofPolicy.
+extern const RetryPolicy DefaultRetryPolicy;
+
+// Protocol of a named session's requests, see CURLOPT_HTTP_VERSION.
+// From HTTP/2 on, concurrent requests of a MultiSession are multiplexed over one connection per host, as they wait for
+// it rather than opening another one. Blocking requests each run on their own easy handle and thus don't share one.
+enum class HttpVersion
+{
+    // libcurl's default, which is HTTP/2 if offered via TLS ALPN and HTTP/1.1 otherwise.
+    Default,
+    Http1_1,
+    // Via TLS ALPN, HTTP/1.1 for plain http.
+    Http2,
+    // Also for plain http without negotiation, so the server must speak HTTP/2.
+    Http2PriorKnowledge,
+    // Over QUIC, falls back to HTTP/2 or 1.1 if the server doesn't answer in time. Http2 if libcurl is built without
+    // HTTP/3, see Factory::IsHttp3Supported().
+    Http3,
+};
+
+// Further per named session options of Factory::PrepareSession().
+struct SessionOptions
+{
+    PoolOptions        pool;
+    ProxySelection     proxySelection = ProxySelection::Healthiest;
+    // Shared by all sessions of the named config.
+    BreakerOptions     breaker;
+    RetryBudgetOptions retryBudget;
+    HedgeOptions       hedge;
+    // Chunk pool of each request of Session::GetStream() and PostStream().
+    StreamOptions      stream;
+    // Records request metrics, see Factory::SessionMetrics().
+    bool metrics = true;
+    // Share of requests (0..1) whose libcurl debug output goes to Factory::Tracing(), e.g. 0.01. Sessions created with
+    // trace=true trace all their requests.
+    double traceSampleRate = 0;
+    // Keeps the attempts of slow requests, see Factory::SlowRequests().
+    SlowRequestOptions slowRequests;
+    DnsOptions         dns;
+    WarmupOptions      warmup;
+    HttpVersion        httpVersion = HttpVersion::Default;
+};
+
+// Progress of a single request through its retry attempts.
+struct RetryState
+{
+    size_t attempt           = 0;
+    size_t nonHttpErrors     = 0;
+    bool   tempProxyDisabled = false;
+    bool   keepProxyDisabled = false;
+    // Whether the request is traced is decided once, before its first attempt. =0 if not traced.
+    bool     traceDecided = false;
+    uint64_t traceId      = 0;
+    // Attempts performed so far, unlike attempt also counting those after a Retry-After.
+    uint32_t performed = 0;
+    // Set on admission of the first attempt.
+    std::chrono::steady_clock::time_point started;
+    AttemptLog                            attempts;
+};
 
 // Implementation is identical to cpr::Url and is intended to hold a relative URL,
 // typically only the path part of an URL.
@@ -77,10 +164,15 @@ public:
 };
 
 class Factory;
+class MultiSession;
 
 class Session
 {
     friend Factory;
+    friend MultiSession;
+    friend BodyStream;
+    friend RangedDownload;
+    friend ConnectionWarmer;
 
 public:
     void SetRetryPolicy(RetryPolicy retryPolicy)
@@ -98,58 +190,316 @@ public:
     {
         if (!_proxy.empty())
         {
-            const std::string protocol = _url.str().substr(0, _url.str().find(':'));
-            _session.SetProxies({{protocol, _proxy}});
+            _session.SetProxies({{std::string(_baseUrl->Scheme()), _proxy}});
         }
     }
 
+    // Traces all requests of the session instead of the sampled ones, see Factory::Tracing().
     void EnableTrace();
 
 private:
-    cpr::Session _session;
-    cpr::Url     _url;
-    Path         _path;
-    std::string  _proxy;
-
-    std::function<void(Session*)>                            _prepper;
-    std::function<void(Session*, std::ofstream&)>            _prepperDlStream;
-    std::function<void(Session*, const cpr::WriteCallback&)> _prepperDlCallback;
+    // Declared before _session as the share has to outlive the easy handle using it.
+    std::shared_ptr<Share>          _share;
+    cpr::Session                    _session;
+    std::string                     _name;
+    std::string                     _proxy;
+    std::shared_ptr<ProxyHealth>    _proxyHealth;
+    std::shared_ptr<CircuitBreaker> _breaker;
+    std::shared_ptr<RetryBudget>    _retryBudget;
+    std::shared_ptr<Hedging>        _hedging;
+    std::shared_ptr<Metrics>        _metrics;
+    std::shared_ptr<SlowRequestLog> _slowRequests;
+    std::shared_ptr<HostResolver>   _resolver;
+    // Got an option cpr::Session keeps, e.g. a body, authentication or a timeout. Such a session isn't reused by a
+    // SessionPool, as the option would carry over to the next lease.
+    bool _customized = false;
+    // Shared with the named config, parsed once.
+    std::shared_ptr<const ParsedUrl> _baseUrl;
+    Path                             _path;
+    // The base URL joined with _path and the query, its capacity is reused by all requests of the session.
+    cpr::Url _requestUrl;
+    // Headers and query parameters of the named config, shared and encoded once.
+    std::shared_ptr<const RequestPreset> _preset;
+    // Set by the cpr::Header and cpr::Parameters options. They stay until replaced or the session is given back to
+    // its pool, as they did in cpr::Session.
+    cpr::Header _headerOverlay;
+    std::string _queryOverlay;
+    // The preset's headers merged with _headerOverlay, =nullptr without overlay.
+    HeaderList _headerList;
+    // The current request was rejected by the open circuit breaker without being performed.
+    bool _rejected = false;
+    // The current request must not be attempted again, e.g. as parts of its body were handed out already.
+    bool _committed = false;
+    // Body of the current request, attached on every attempt.
+    UploadSource _upload;
+    // The resolver's addresses as handed to libcurl, which keeps using the list.
+    std::shared_ptr<curl_slist> _resolveList;
+    uint64_t                    _resolveGeneration = 0;
+
+    struct MultiDeleter
+    {
+        void operator()(CURLM* multi) const
+        {
+            curl_multi_cleanup(multi);
+        }
+    };
+    // Waits for a hedged request and its hedge. Kept across requests, as connections stay in its cache.
+    std::unique_ptr<CURLM, MultiDeleter> _hedgeMulti;
 
-    std::variant<std::ofstream*, const cpr::WriteCallback*> _prepperArgs;
+    // Preparation of requests which are stored and attempted later by other code than the verb method called, i.e.
+    // async, multi, streamed and ranged requests as well as hedged ones. Synchronous requests pass theirs as template
+    // argument instead.
+    std::function<void(Session*)> _prepper;
 
-    struct DebugData
+    // The preparation of a verb as a type of its own, so each verb gets its own instance of the request path.
+    template <void (Session::*prepper)()>
+    struct Verb
     {
-        DebugData()
+        void operator()(Session* session) const
         {
-            traceAscii = true;
+            (session->*prepper)();
         }
-        bool traceAscii;
     };
+
     RetryPolicy _retryPolicy;
-    DebugData   _debugData;
-    static int  curl_trace(CURL* handle, curl_infotype type, char* data, size_t size, void* userp);
-    static void dump(const char* text, FILE* stream, unsigned char* ptr, size_t size, bool nohex);
 
-    void SetUrl(const cpr::Url& url)
+    bool   _traceAll        = false;
+    double _traceSampleRate = 0;
+    // Of the current request and attempt, as recorded with its events.
+    uint64_t   _traceId      = 0;
+    uint32_t   _traceAttempt = 0;
+    bool       _verbose      = false;
+    static int curl_trace(CURL* handle, curl_infotype type, char* data, size_t size, void* userp);
+    // Turns the debug output on or off for the request of state.
+    void trace(RetryState& state);
+
+    // Prepares the next attempt via prepper, a Verb, a lambda or _prepper.
+    template <typename Prepper>
+    void prepare(const Prepper& prepper)
+    {
+        _committed = false;
+        prepper(this);
+
+        // Replaces the header list cpr built, which then only holds its defaults.
+        curl_easy_setopt(
+            _session.GetCurlHolder()->handle, CURLOPT_HTTPHEADER, _headerList ? _headerList.get() : _preset->Headers());
+
+        if (_upload)
+            _upload.attach(_session.GetCurlHolder()->handle);
+
+        if (_resolver && _resolver->Generation() != _resolveGeneration)
+            updateResolve();
+    }
+    void updateResolve();
+    void prepare()
+    {
+        prepare(_prepper);
+    }
+
+    template <typename Prepper>
+    CURLcode makeRepeatedRequestEx(const Prepper& prepper, RetryState& state)
+    {
+        if (!admit(state))
+            return CURLE_ABORTED_BY_CALLBACK;
+
+        prepare(prepper);
+        return performAttempts(state, prepper);
+    }
+
+    template <typename Prepper>
+    CURLcode performAttempts(RetryState& state, const Prepper& prepper)
+    {
+        CURL*    curl = _session.GetCurlHolder()->handle;
+        CURLcode curl_error;
+
+        while (1)
+        {
+            curl_error = curl_easy_perform(curl);
+
+            auto waitMilliSeconds = nextAttempt(curl_error, state);
+            if (!waitMilliSeconds)
+                break;
+
+            std::this_thread::sleep_for(*waitMilliSeconds);
+            prepare(prepper);
+        };
+
+        finishAttempts(state);
+
+        return curl_error;
+    }
+
+    // Evaluates a finished request attempt. Returns the time to wait before the next attempt or std::nullopt if
+    // no further attempt shall be made. With resumable, a transfer failing after a 2xx header is retried too, as the
+    // next attempt continues where it stopped.
+    std::optional<std::chrono::milliseconds> nextAttempt(
+        CURLcode curl_error, RetryState& state, bool resumable = false);
+    void                                     finishAttempts(const RetryState& state);
+    void                                     detachUpload();
+    // Asks the circuit breaker before the first attempt of a request, later ones ask in nextAttempt(). Also decides
+    // whether the request is traced.
+    bool admit(RetryState& state);
+    // The admitted attempt won't be performed or won't finish, e.g. as it got cancelled.
+    void abandon();
+    // Hands the attempt log of state over to the response.
+    Response complete(CURLcode curl_error, RetryState& state);
+    Response completeDownload(CURLcode curl_error, RetryState& state);
+    Response withAttempts(Response response, RetryState& state);
+
+    template <typename Prepper>
+    Response makeRequestEx(const Prepper& prepper)
+    {
+        RetryState state;
+        return complete(makeRepeatedRequestEx(prepper, state), state);
+    }
+
+    template <typename Prepper>
+    Response makeDownloadRequestEx(const Prepper& prepper)
     {
-        _url = url;
-        _session.SetUrl(url);
+        RetryState state;
+        return completeDownload(makeRepeatedRequestEx(prepper, state), state);
     }
 
-    void          prepare();
-    CURLcode      makeRepeatedRequestEx();
-    cpr::Response makeRequestEx();
-    cpr::Response makeDownloadRequestEx();
+    void            prepareSink(FileSink& sink);
+    static Response closeSink(FileSink& sink, Response response);
+
+    // GET, HEAD and OPTIONS, which are hedged if the named config enables it.
+    template <typename Prepper, typename... Ts>
+    Response makeIdempotentRequestEx(Prepper prepper, Ts&&... ts)
+    {
+        if (!_hedging)
+        {
+            set_option(std::forward<Ts>(ts)...);
+            return makeRequestEx(prepper);
+        }
+
+        // The hedge is another session which needs its own copy of the options.
+        auto args = std::make_tuple(std::decay_t<Ts>(ts)...);
+        set_option(std::forward<Ts>(ts)...);
+        _prepper = prepper;
+        return makeHedgedRequestEx([prepper, &args](Session& hedge) {
+            hedge.set_option_copies(args);
+            hedge._prepper = prepper;
+        });
+    }
+    // Only the first attempt is hedged, the winner's response is returned.
+    Response makeHedgedRequestEx(const std::function<void(Session&)>& prepareHedge);
+    // Performs the prepared request and, if it takes too long, a hedge leased into hedge. Returns the result of the
+    // one finishing first, which is the hedge if hedge is set on return.
+    CURLcode performHedged(const std::function<void(Session&)>& prepareHedge, SessionLease& hedge);
 
     std::chrono::milliseconds ParseRetryAfterHeader();
 
+    // A request run on the Factory's worker pool by a pooled Session of the same named config.
+    // Between attempts it is parked in Factory::RetryScheduler() and thus doesn't occupy a worker while waiting.
+    // complete and fail shall not throw, the latter gets what was thrown before the request could complete, e.g. as
+    // its named config is gone.
+    struct AsyncRequest
+    {
+        std::string                                          name;
+        std::function<void(Session&)>                        prepare;
+        std::function<void(Session&, CURLcode, RetryState&)> complete;
+        std::function<void(std::exception_ptr)>              fail;
+        RetryState                                           state;
+    };
+    static void runAsync(std::shared_ptr<AsyncRequest> request);
+
+    void enqueueAsync(std::function<void(Session&)> prepare,
+        std::function<void(Session&, CURLcode, RetryState&)> complete, std::function<void(std::exception_ptr)> fail)
+    {
+        auto request      = std::make_shared<AsyncRequest>();
+        request->name     = _name;
+        request->prepare  = std::move(prepare);
+        request->complete = std::move(complete);
+        request->fail     = std::move(fail);
+        runAsync(std::move(request));
+    }
+
+    template <typename Prepper, typename... Ts>
+    AsyncResponse submitAsync(Prepper prepper, Ts... ts)
+    {
+        return submitCallback(prepper, [](Response r) { return r; }, std::move(ts)...);
+    }
+
+    template <typename Prepper, typename Then, typename... Ts>
+    // NOLINTNEXTLINE(fuchsia-trailing-return)
+    auto submitCallback(Prepper prepper, Then then, Ts... ts)
+    {
+        using Result = std::invoke_result_t<Then, Response>;
+
+        auto promise = std::make_shared<std::promise<Result>>();
+        auto future  = promise->get_future();
+        enqueueAsync(
+            [prepper, args = std::make_tuple(std::move(ts)...)](Session& session) {
+                session.set_option_copies(args);
+                session._prepper = prepper;
+            },
+            [promise, then = std::move(then)](Session& session, CURLcode curl_error, RetryState& state) {
+                try
+                {
+                    if constexpr (std::is_void_v<Result>)
+                    {
+                        then(session.complete(curl_error, state));
+                        promise->set_value();
+                    }
+                    else
+                    {
+                        promise->set_value(then(session.complete(curl_error, state)));
+                    }
+                }
+                catch (...)
+                {
+                    promise->set_exception(std::current_exception());
+                }
+            },
+            [promise](std::exception_ptr error) { promise->set_exception(error); });
+        return cpr::AsyncWrapper<Result> {std::move(future)};
+    }
+
+    StreamOptions streamOptions() const;
+
+    template <typename Prepper, typename... Ts>
+    BodyStream submitStream(Prepper prepper, Ts... ts)
+    {
+        BodyStream stream(streamOptions());
+        auto       lease = acquire();
+        lease->set_option(std::move(ts)...);
+        lease->_prepper = [prepper, state = stream._state](Session* self) {
+            prepper(self);
+            BodyStream::attach(state, *self);
+        };
+        enqueueStream(std::move(lease), stream._state);
+        return stream;
+    }
+    // A session of the same named config from its pool.
+    SessionLease acquire() const;
+    // Hands the request over to Factory::Streams().
+    static void enqueueStream(SessionLease lease, std::shared_ptr<BodyStream::State> state);
+
 #ifdef _WIN32
 #    pragma region Option setter
 #endif
     void SetPath(const Path& path)
     {
         _path = path;
-        _session.SetUrl(AppendUrls(std::string(_url), std::string(_path)));
+        composeUrl();
+    }
+
+    void composeUrl()
+    {
+        auto& url = _requestUrl.str();
+        AppendUrls(url, _baseUrl->Str(), _path.str());
+
+        auto appendQuery = [&url](const std::string& query) {
+            if (query.empty())
+                return;
+            url += url.find('?') == std::string::npos ? '?' : '&';
+            url += query;
+        };
+        appendQuery(_preset->Query());
+        appendQuery(_queryOverlay);
+
+        _session.SetUrl(_requestUrl);
     }
 
     template <bool processed_header, typename CurrentType>
@@ -159,7 +509,31 @@ private:
             "You shall not pass cpr::Url(\"...\"), instead use Path(\"relative/path\"). "
             "Absolute URLs should be passed via Session::Factory::PrepareSession()");
 
-        _session.SetOption(std::forward<CurrentType>(current_option));
+        if constexpr (std::is_same_v<std::decay_t<CurrentType>, UploadSource>)
+        {
+            _upload = std::forward<CurrentType>(current_option);
+        }
+        else if constexpr (std::is_same_v<std::decay_t<CurrentType>, cpr::Header>)
+        {
+            // The first header option of a request replaces the previous overlay, further ones update it.
+            if constexpr (!processed_header)
+                _headerOverlay.clear();
+            for (const auto& [name, value] : current_option)
+                _headerOverlay.insert_or_assign(name, value);
+            _headerList = _preset->Merge(_headerOverlay);
+        }
+        else if constexpr (std::is_same_v<std::decay_t<CurrentType>, cpr::Parameters>)
+        {
+            // Encoded here once, cpr would do it on every attempt.
+            _queryOverlay = current_option.GetContent(*_session.GetCurlHolder());
+            composeUrl();
+        }
+        else
+        {
+            // cpr::Session has no way to drop them again.
+            _customized = true;
+            _session.SetOption(std::forward<CurrentType>(current_option));
+        }
     }
 
     template <>
@@ -168,20 +542,12 @@ private:
         SetPath(std::forward<Path>(current_option));
     }
 
-    template <>
-    void set_option_internal<true, cpr::Header>(cpr::Header&& current_option)
-    {
-        // Header option was already provided -> Update previous header
-        _session.UpdateHeader(std::forward<cpr::Header>(current_option));
-    }
-
     template <bool processed_header, typename CurrentType, typename... Ts>
     void set_option_internal(CurrentType&& current_option, Ts&&... ts)
     {
-        // This was in cpr::Session, but seems useless:
-        // set_option_internal<processed_header, CurrentType>(std::forward<CurrentType>(current_option));
+        set_option_internal<processed_header, CurrentType>(std::forward<CurrentType>(current_option));
 
-        if (std::is_same<CurrentType, cpr::Header>::value)
+        if (std::is_same<std::decay_t<CurrentType>, cpr::Header>::value)
         {
             set_option_internal<true, Ts...>(std::forward<Ts>(ts)...);
         }
@@ -196,6 +562,13 @@ private:
     {
         set_option_internal<false, Ts...>(std::forward<Ts>(ts)...);
     }
+
+    // Applies copies of stored options, e.g. when a request is attempted again after it was parked.
+    template <typename... Ts>
+    void set_option_copies(const std::tuple<Ts...>& options)
+    {
+        std::apply([this](const Ts&... ts) { set_option(Ts(ts)...); }, options);
+    }
 #ifdef _WIN32
 #    pragma endregion
 #endif
@@ -216,18 +589,16 @@ public:
 
     // Get methods
     template <typename... Ts>
-    cpr::Response Get(Ts&&... ts)
+    Response Get(Ts&&... ts)
     {
-        set_option(std::forward<Ts>(ts)...);
-        _prepper = &Session::PrepareGet;
-        return makeRequestEx();
+        return makeIdempotentRequestEx(Verb<&Session::PrepareGet> {}, std::forward<Ts>(ts)...);
     }
 
     // Get async methods
     template <typename... Ts>
-    cpr::AsyncResponse GetAsync(Ts... ts)
+    AsyncResponse GetAsync(Ts... ts)
     {
-        return cpr::async([](Ts... ts_inner) { return Get(std::move(ts_inner)...); }, std::move(ts)...);
+        return submitAsync(Verb<&Session::PrepareGet> {}, std::move(ts)...);
     }
 
     // Get callback methods
@@ -235,24 +606,29 @@ public:
     // NOLINTNEXTLINE(fuchsia-trailing-return)
     auto GetCallback(Then then, Ts... ts)
     {
-        return cpr::async([](Then then_inner, Ts... ts_inner) { return then_inner(Get(std::move(ts_inner)...)); },
-            std::move(then), std::move(ts)...);
+        return submitCallback(Verb<&Session::PrepareGet> {}, std::move(then), std::move(ts)...);
+    }
+
+    // Get streaming methods, see BodyStream
+    template <typename... Ts>
+    BodyStream GetStream(Ts... ts)
+    {
+        return submitStream(Verb<&Session::PrepareGet> {}, std::move(ts)...);
     }
 
     // Post methods
     template <typename... Ts>
-    cpr::Response Post(Ts&&... ts)
+    Response Post(Ts&&... ts)
     {
         set_option(std::forward<Ts>(ts)...);
-        _prepper = &Session::PreparePost;
-        return makeRequestEx();
+        return makeRequestEx(Verb<&Session::PreparePost> {});
     }
 
     // Post async methods
     template <typename... Ts>
-    cpr::AsyncResponse PostAsync(Ts... ts)
+    AsyncResponse PostAsync(Ts... ts)
     {
-        return cpr::async([](Ts... ts_inner) { return Post(std::move(ts_inner)...); }, std::move(ts)...);
+        return submitAsync(Verb<&Session::PreparePost> {}, std::move(ts)...);
     }
 
     // Post callback methods
@@ -260,24 +636,29 @@ public:
     // NOLINTNEXTLINE(fuchsia-trailing-return)
     auto PostCallback(Then then, Ts... ts)
     {
-        return cpr::async([](Then then_inner, Ts... ts_inner) { return then_inner(Post(std::move(ts_inner)...)); },
-            std::move(then), std::move(ts)...);
+        return submitCallback(Verb<&Session::PreparePost> {}, std::move(then), std::move(ts)...);
+    }
+
+    // Post streaming methods, see BodyStream
+    template <typename... Ts>
+    BodyStream PostStream(Ts... ts)
+    {
+        return submitStream(Verb<&Session::PreparePost> {}, std::move(ts)...);
     }
 
     // Put methods
     template <typename... Ts>
-    cpr::Response Put(Ts&&... ts)
+    Response Put(Ts&&... ts)
     {
         set_option(std::forward<Ts>(ts)...);
-        _prepper = &Session::PreparePut;
-        return makeRequestEx();
+        return makeRequestEx(Verb<&Session::PreparePut> {});
     }
 
     // Put async methods
     template <typename... Ts>
-    cpr::AsyncResponse PutAsync(Ts... ts)
+    AsyncResponse PutAsync(Ts... ts)
     {
-        return cpr::async([](Ts... ts_inner) { return Put(std::move(ts_inner)...); }, std::move(ts)...);
+        return submitAsync(Verb<&Session::PreparePut> {}, std::move(ts)...);
     }
 
     // Put callback methods
@@ -285,24 +666,21 @@ public:
     // NOLINTNEXTLINE(fuchsia-trailing-return)
     auto PutCallback(Then then, Ts... ts)
     {
-        return cpr::async([](Then then_inner, Ts... ts_inner) { return then_inner(Put(std::move(ts_inner)...)); },
-            std::move(then), std::move(ts)...);
+        return submitCallback(Verb<&Session::PreparePut> {}, std::move(then), std::move(ts)...);
     }
 
     // Head methods
     template <typename... Ts>
-    cpr::Response Head(Ts&&... ts)
+    Response Head(Ts&&... ts)
     {
-        set_option(std::forward<Ts>(ts)...);
-        _prepper = &Session::PrepareHead;
-        return makeRequestEx();
+        return makeIdempotentRequestEx(Verb<&Session::PrepareHead> {}, std::forward<Ts>(ts)...);
     }
 
     // Head async methods
     template <typename... Ts>
-    cpr::AsyncResponse HeadAsync(Ts... ts)
+    AsyncResponse HeadAsync(Ts... ts)
     {
-        return cpr::async([](Ts... ts_inner) { return Head(std::move(ts_inner)...); }, std::move(ts)...);
+        return submitAsync(Verb<&Session::PrepareHead> {}, std::move(ts)...);
     }
 
     // Head callback methods
@@ -310,24 +688,22 @@ public:
     // NOLINTNEXTLINE(fuchsia-trailing-return)
     auto HeadCallback(Then then, Ts... ts)
     {
-        return cpr::async([](Then then_inner, Ts... ts_inner) { return then_inner(Head(std::move(ts_inner)...)); },
-            std::move(then), std::move(ts)...);
+        return submitCallback(Verb<&Session::PrepareHead> {}, std::move(then), std::move(ts)...);
     }
 
     // Delete methods
     template <typename... Ts>
-    cpr::Response Delete(Ts&&... ts)
+    Response Delete(Ts&&... ts)
     {
         set_option(std::forward<Ts>(ts)...);
-        _prepper = &Session::PrepareDelete;
-        return makeRequestEx();
+        return makeRequestEx(Verb<&Session::PrepareDelete> {});
     }
 
     // Delete async methods
     template <typename... Ts>
-    cpr::AsyncResponse DeleteAsync(Ts... ts)
+    AsyncResponse DeleteAsync(Ts... ts)
     {
-        return cpr::async([](Ts... ts_inner) { return Delete(std::move(ts_inner)...); }, std::move(ts)...);
+        return submitAsync(Verb<&Session::PrepareDelete> {}, std::move(ts)...);
     }
 
     // Delete callback methods
@@ -335,24 +711,21 @@ public:
     // NOLINTNEXTLINE(fuchsia-trailing-return)
     auto DeleteCallback(Then then, Ts... ts)
     {
-        return cpr::async([](Then then_inner, Ts... ts_inner) { return then_inner(Delete(std::move(ts_inner)...)); },
-            std::move(then), std::move(ts)...);
+        return submitCallback(Verb<&Session::PrepareDelete> {}, std::move(then), std::move(ts)...);
     }
 
     // Options methods
     template <typename... Ts>
-    cpr::Response Options(Ts&&... ts)
+    Response Options(Ts&&... ts)
     {
-        set_option(std::forward<Ts>(ts)...);
-        _prepper = &Session::PrepareOptions;
-        return makeRequestEx();
+        return makeIdempotentRequestEx(Verb<&Session::PrepareOptions> {}, std::forward<Ts>(ts)...);
     }
 
     // Options async methods
     template <typename... Ts>
-    cpr::AsyncResponse OptionsAsync(Ts... ts)
+    AsyncResponse OptionsAsync(Ts... ts)
     {
-        return cpr::async([](Ts... ts_inner) { return Options(std::move(ts_inner)...); }, std::move(ts)...);
+        return submitAsync(Verb<&Session::PrepareOptions> {}, std::move(ts)...);
     }
 
     // Options callback methods
@@ -360,24 +733,22 @@ public:
     // NOLINTNEXTLINE(fuchsia-trailing-return)
     auto OptionsCallback(Then then, Ts... ts)
     {
-        return cpr::async([](Then then_inner, Ts... ts_inner) { return then_inner(Options(std::move(ts_inner)...)); },
-            std::move(then), std::move(ts)...);
+        return submitCallback(Verb<&Session::PrepareOptions> {}, std::move(then), std::move(ts)...);
     }
 
     // Patch methods
     template <typename... Ts>
-    cpr::Response Patch(Ts&&... ts)
+    Response Patch(Ts&&... ts)
     {
         set_option(std::forward<Ts>(ts)...);
-        _prepper = &Session::PreparePatch;
-        return makeRequestEx();
+        return makeRequestEx(Verb<&Session::PreparePatch> {});
     }
 
     // Patch async methods
     template <typename... Ts>
-    cpr::AsyncResponse PatchAsync(Ts... ts)
+    AsyncResponse PatchAsync(Ts... ts)
     {
-        return cpr::async([](Ts... ts_inner) { return Patch(std::move(ts_inner)...); }, std::move(ts)...);
+        return submitAsync(Verb<&Session::PreparePatch> {}, std::move(ts)...);
     }
 
     // Patch callback methods
@@ -385,43 +756,68 @@ public:
     // NOLINTNEXTLINE(fuchsia-trailing-return)
     auto PatchCallback(Then then, Ts... ts)
     {
-        return cpr::async([](Then then_inner, Ts... ts_inner) { return then_inner(Patch(std::move(ts_inner)...)); },
-            std::move(then), std::move(ts)...);
+        return submitCallback(Verb<&Session::PreparePatch> {}, std::move(then), std::move(ts)...);
     }
 
     // Download methods
     template <typename... Ts>
-    cpr::Response Download(std::ofstream& file, Ts&&... ts)
+    Response Download(std::ofstream& file, Ts&&... ts)
     {
         set_option(std::forward<Ts>(ts)...);
-        _prepper         = nullptr;
-        _prepperDlStream = static_cast<void (cpr::Session::*)(std::ofstream&)>(&Session::PrepareDownload);
-        _prepperArgs     = &file;
-        return makeDownloadRequestEx();
+        return makeDownloadRequestEx([&file](Session* self) { self->PrepareDownload(file); });
     }
 
     // Download async method
     template <typename... Ts>
-    cpr::AsyncResponse DownloadAsync(cpr::fs::path local_path, Ts... ts)
-    {
-        return cpr::AsyncWrapper {std::async(
-            std::launch::async,
-            [](cpr::fs::path local_path_, Ts... ts_) {
-                std::ofstream f(local_path_.c_str());
-                return Download(f, std::move(ts_)...);
+    AsyncResponse DownloadAsync(cpr::fs::path local_path, Ts... ts)
+    {
+        auto sink    = std::make_shared<FileSink>(local_path);
+        auto promise = std::make_shared<std::promise<Response>>();
+        auto future  = promise->get_future();
+        enqueueAsync(
+            [sink, args = std::make_tuple(std::move(ts)...)](Session& session) {
+                session.set_option_copies(args);
+                session._prepper = [sink](Session* self) { self->prepareSink(*sink); };
             },
-            std::move(local_path), std::move(ts)...)};
+            [sink, promise](Session& session, CURLcode curl_error, RetryState& state) {
+                try
+                {
+                    promise->set_value(closeSink(*sink, session.completeDownload(curl_error, state)));
+                }
+                catch (...)
+                {
+                    promise->set_exception(std::current_exception());
+                }
+            },
+            [promise](std::exception_ptr error) { promise->set_exception(error); });
+        return AsyncResponse {std::move(future)};
+    }
+
+    // Download into a FileSink, which is closed afterwards
+    template <typename... Ts>
+    Response Download(FileSink& sink, Ts&&... ts)
+    {
+        set_option(std::forward<Ts>(ts)...);
+        return closeSink(sink, makeDownloadRequestEx([&sink](Session* self) { self->prepareSink(sink); }));
+    }
+
+    // Download into a file, fetched in concurrent byte ranges if the server supports them, see RangedDownload.
+    template <typename... Ts>
+    Response DownloadFile(const cpr::fs::path& path, const RangedDownloadOptions& options, Ts... ts)
+    {
+        auto args = std::make_tuple(std::move(ts)...);
+        return RangedDownload(*this, path, options, [args](Session& session) { session.set_option_copies(args); })
+            .Run();
     }
 
     // Download with user callback
     template <typename... Ts>
-    cpr::Response Download(const cpr::WriteCallback& write, Ts&&... ts)
+    Response Download(const cpr::WriteCallback& write, Ts&&... ts)
     {
+        // cpr::Session keeps the callback, which would receive the next lease's bodies.
+        _customized = true;
         set_option(std::forward<Ts>(ts)...);
-        _prepper           = nullptr;
-        _prepperDlCallback = static_cast<void (cpr::Session::*)(const cpr::WriteCallback&)>(&Session::PrepareDownload);
-        _prepperArgs       = &write;
-        return makeDownloadRequestEx();
+        return makeDownloadRequestEx([&write](Session* self) { self->PrepareDownload(write); });
     }
 #ifdef _WIN32
 #    pragma endregion
@@ -430,36 +826,106 @@ public:
 
 class Factory final
 {
+    friend Session;
+    friend MultiSession;
+
     Factory() = delete;
 
     struct Entry
     {
-        Entry();
-        ~Entry();
-
-        std::string              name;
-        CURLSH*                  share;
-        std::string              baseUrl;
-        cpr::Header              header;
-        cpr::Parameters          parameters;
-        cpr::Redirect            redirect;
-        RetryPolicy              retryPolicy;
-        std::vector<std::string> proxies;
+        std::string                          name;
+        std::shared_ptr<Share>               share = std::make_shared<Share>();
+        std::shared_ptr<const ParsedUrl>     baseUrl;
+        std::shared_ptr<const RequestPreset> preset;
+        cpr::Redirect                        redirect;
+        RetryPolicy                          retryPolicy;
+        std::shared_ptr<ProxyGroup>          proxies;
+        // nullptr if disabled.
+        std::shared_ptr<CircuitBreaker>   breaker;
+        std::shared_ptr<RetryBudget>      retryBudget;
+        std::shared_ptr<Hedging>          hedging;
+        std::shared_ptr<Metrics>          metrics;
+        std::shared_ptr<SlowRequestLog>   slowRequests;
+        std::shared_ptr<HostResolver>     resolver;
+        std::shared_ptr<ConnectionWarmer> warmer;
+        SessionOptions                    options;
+        std::shared_ptr<SessionPool>      pool;
     };
-    static std::map<std::string, Entry> _namedSessionsData;
-    static pxProxyFactory*              _proxyFactory;
-    static std::mutex                   _proxyFactoryMtx;
+    // Entries aren't changed once stored, preparing a name again replaces its entry as a whole. Looked up from any
+    // thread, e.g. by the pools and warmers, while PrepareSession() may add others.
+    static std::map<std::string, std::shared_ptr<const Entry>> _namedSessionsData;
+    static std::shared_mutex                                   _namedSessionsMtx;
+    static size_t                                              _workerThreads;
 
 public:
     static Session CreateSession(const std::string& name, bool trace = false);
 
+    // Leases an already configured session of the named config, which is reset to the config's baseline and given
+    // back to the pool once the lease is destroyed. See SessionOptions::pool for sizing.
+    // Only requests passing nothing but Path, cpr::Header, cpr::Parameters and UploadSource options leave the session
+    // reusable, any other option makes the pool destroy it.
+    static SessionLease AcquireSession(const std::string& name);
+
+    // Creates a session which runs all its requests concurrently on a single curl_multi handle.
+    static MultiSession CreateMulti(const std::string& name, bool trace = false);
+
+    // Cookie, DNS and TLS session cache shared by all sessions of the named config.
+    static Share& SharedCache(const std::string& name);
+
+    // How often hedges of the named config fired and won, all zero if hedging is disabled.
+    static Hedging::Stats HedgeStats(const std::string& name);
+
+    // Request metrics of the named config, all zero if disabled via SessionOptions::metrics.
+    static MetricsSnapshot SessionMetrics(const std::string& name);
+    // Metrics of all named configs in the Prometheus text exposition format.
+    static std::string PrometheusMetrics();
+
+    // The most recent requests of the named config taking longer than SessionOptions::slowRequests.threshold, oldest
+    // first. See SlowRequestLog::Format() for a dump.
+    static std::vector<SlowRequest> SlowRequests(const std::string& name);
+
+    // Connections kept open by SessionOptions::warmup and sessions idle in the pool of the named config.
+    static ConnectionWarmer::Stats WarmupStats(const std::string& name);
+
+    // Whether libcurl was built with HTTP/3 support.
+    static bool IsHttp3Supported();
+
+    // Parks requests of all sessions which wait for their next retry attempt.
+    static Scheduler& RetryScheduler();
+
+    // Receives the debug output of traced requests of all sessions, see SessionOptions::traceSampleRate.
+    static Tracer& Tracing();
+
+    // Number of threads running the *Async and *Callback verbs of all sessions.
+    // Shall be called before the first async request, =0 uses the number of hardware threads.
+    static void        SetWorkerThreads(size_t threads);
+    static WorkerPool& Workers();
+
+    // A single thread for background rounds which may block for a while, i.e. proxy probes and connection warm-up,
+    // so they don't take workers away from requests.
+    static WorkerPool& Maintenance();
+
+    // Event loop running the streamed requests of all sessions, see BodyStream. A transfer paused as its consumer
+    // falls behind thus takes no thread.
+    static MultiSession& Streams();
+
     // baseUrl is assumed as an absolute URL as in https://datatracker.ietf.org/doc/html/rfc3986
     static void PrepareSession(const std::string& name, const std::string& baseUrl, const cpr::Header& header = {},
         const cpr::Parameters& parameters = {}, const cpr::Redirect& redirect = {},
-        RetryPolicy retryPolicy = DefaultRetryPolicy);
+        RetryPolicy retryPolicy = DefaultRetryPolicy, const SessionOptions& options = {});
 
 private:
-    static bool IsProxyReachable(const std::string& url);
+    static std::shared_ptr<const Entry> FindEntry(const std::string& name);
+    // nullptr if the name wasn't prepared.
+    static std::shared_ptr<const Entry> LookupEntry(const std::string& name);
+    // Picks a proxy of the entry according to its SessionOptions::proxySelection, returns nullptr to go direct.
+    // Waits for the entry's proxy discovery if that is still running.
+    static std::shared_ptr<ProxyHealth> SelectProxy(const Entry& entry);
+    static void ConfigureSession(
+        Session& session, const Entry& entry, const std::shared_ptr<ProxyHealth>& proxy, bool trace);
+
+    static std::unique_ptr<Session> NewPooledSession(const std::string& name);
+    static bool                     ResetPooledSession(Session& session);
 };
 
 }
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "proxy.h" // https://github.com/libproxy/libproxy
+
+namespace cprex
+{
+// Proxy autodiscovery via libproxy, which may have to fetch and evaluate a PAC script and thus blocks for a while.
+// Lookups run in the background and are cached per scheme+host, so named sessions pointing to the same host share
+// one lookup. Once the TTL has passed, the cached proxies keep being served while a refresh runs. A refresh which
+// finished replaces them on the next Lookup(), which bumps the generation of the host's entry.
+class ProxyDiscovery final
+{
+    ProxyDiscovery() = delete;
+
+public:
+    using Proxies = std::vector<std::string>;
+
+    // Starts a lookup for url unless one for the same scheme+host is cached or running. generation, if given, receives
+    // the number of refreshes the returned proxies went through, so callers notice a refreshed result.
+    static std::shared_future<Proxies> Lookup(const std::string& url, uint64_t* generation = nullptr);
+
+    static void SetTtl(std::chrono::seconds ttl);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Cached
+    {
+        std::shared_future<Proxies> proxies;
+        // Replaces proxies once ready.
+        std::shared_future<Proxies> refresh;
+        Clock::time_point           expires;
+        uint64_t                    generation = 0;
+    };
+
+    static std::string                 Key(const std::string& url);
+    static std::shared_future<Proxies> Start(const std::string& url);
+    static Proxies                     Query(const std::string& url);
+
+    static std::mutex                    _cacheMtx;
+    static std::map<std::string, Cached> _cache;
+    static std::chrono::seconds          _ttl;
+
+    static pxProxyFactory* _proxyFactory;
+    static std::mutex      _proxyFactoryMtx;
+};
+}
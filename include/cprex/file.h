@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+#include <cpr/cpr.h> // https://github.com/libcpr/cpr
+
+namespace cprex
+{
+// Output file written at explicit offsets via pwrite() or overlapped WriteFile(), so concurrent writers of different
+// parts need neither a shared file position nor a lock. Alternatively written via memory mappings.
+// Opened for reading it serves reads at explicit offsets the same way.
+class File final
+{
+public:
+    enum class Access
+    {
+        // Creates or truncates the file.
+        Write,
+        Read,
+    };
+
+    explicit File(const cpr::fs::path& path, Access access = Access::Write);
+    ~File();
+
+    File(const File&)            = delete;
+    File& operator=(const File&) = delete;
+
+    // Reserves the disk space up front, which avoids fragmentation and fails early if the disk is too full.
+    void Preallocate(uint64_t size);
+    // Sets the file size, e.g. when the final size wasn't known in advance.
+    void Resize(uint64_t size);
+
+    void WriteAt(uint64_t offset, const char* data, size_t size);
+    // Returns the bytes read, less than size only at the end of the file.
+    size_t   ReadAt(uint64_t offset, char* data, size_t size);
+    uint64_t Size() const;
+    // Flushes the written data to the disk.
+    void Sync();
+
+    // Offsets of mappings are multiples of this.
+    static size_t MapAlignment();
+    // Maps size bytes at offset for writing, the file has to be large enough already.
+    char* Map(uint64_t offset, size_t size);
+    void  Unmap(char* data, size_t size);
+    // Flushes the mapped data to the file, Sync() still has to follow for the disk.
+    void FlushMapping(char* data, size_t size);
+
+private:
+#ifdef _WIN32
+    void* _handle;
+#else
+    int _fd;
+#endif
+};
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "url.h"
+
+namespace cprex
+{
+// Reachability of a single proxy, shared by all named sessions using it.
+// Written by the background prober and by requests going through the proxy, read lock-free on session creation.
+struct ProxyHealth
+{
+    explicit ProxyHealth(std::string proxyUrl) : url(std::move(proxyUrl))
+    {
+    }
+
+    const ParsedUrl url;
+
+    // Optimistic until the first probe tells otherwise.
+    std::atomic<bool> reachable = true;
+    // Milliseconds since the steady clock's epoch, =0 if never probed.
+    std::atomic<int64_t> lastProbe = 0;
+    // Exponentially weighted moving average of the probe latency in microseconds, =0 if unknown.
+    std::atomic<uint32_t> latencyEwma = 0;
+    // Failed probes or requests in a row.
+    std::atomic<uint32_t> consecutiveFailures = 0;
+
+    void RecordProbe(bool success, std::chrono::microseconds latency);
+    void RecordRequest(bool success);
+};
+
+// How a session picks one of the reachable proxies of its named config.
+// Sessions keep their proxy, so the choice decides how well the connections kept by pooled sessions get reused.
+enum class ProxySelection
+{
+    // The one with the least failures in a row and the lowest latency.
+    Healthiest,
+    // The first one in the order given by the proxy configuration.
+    StickyFirst,
+    // The same proxy for the same named session as long as it stays reachable (rendezvous hashing).
+    ConsistentHashByName,
+    // The same proxy for the same thread as long as it stays reachable (rendezvous hashing).
+    ConsistentHashByThread,
+    // Random, with a probability inverse to the latency.
+    LatencyWeighted,
+    RoundRobin,
+};
+
+// The proxies discovered for a named session's base URL, ranked by their health.
+class ProxyGroup final : public std::enable_shared_from_this<ProxyGroup>
+{
+public:
+    using ProxyList = std::vector<std::shared_ptr<ProxyHealth>>;
+
+    explicit ProxyGroup(const std::string& url);
+
+    ProxyGroup(const ProxyGroup&)            = delete;
+    ProxyGroup& operator=(const ProxyGroup&) = delete;
+
+    // Waits for the proxy discovery on the first call, which also starts probing. Later calls pick up the result of a
+    // discovery refreshed after its TTL, without waiting for it.
+    std::shared_ptr<const ProxyList> Proxies();
+
+    // A reachable proxy picked according to selection or nullptr to go direct.
+    // Healthiest and StickyFirst are O(1) as the ranking is kept up to date by the prober.
+    std::shared_ptr<ProxyHealth> Select(ProxySelection selection, const std::string& name);
+
+    void Rank();
+
+private:
+    // The proxies of one discovery result with their ranking, replaced as a whole once the discovery is refreshed.
+    struct Ranked
+    {
+        ProxyList proxies;
+        // Indices into proxies, <0 if none is reachable.
+        std::atomic<int> best  = -1;
+        std::atomic<int> first = -1;
+        // Bit i set if proxies[i] is reachable, proxies beyond 64 are never picked.
+        std::atomic<uint64_t> usable = 0;
+    };
+
+    std::shared_ptr<Ranked> ranked();
+    // Asks the discovery cache for a refreshed result, at most once a second.
+    void refresh();
+    void use(const std::vector<std::string>& proxies);
+
+    static void                         rank(Ranked& ranked);
+    static std::shared_ptr<ProxyHealth> SelectByHash(const Ranked& ranked, uint64_t key);
+    static std::shared_ptr<ProxyHealth> SelectByLatency(const Ranked& ranked);
+
+    const std::string                            _url;
+    std::shared_future<std::vector<std::string>> _discovery;
+    std::once_flag                               _resolved;
+    std::atomic<std::shared_ptr<Ranked>>         _ranked;
+    std::atomic<uint64_t>                        _next = 0;
+
+    // Milliseconds since the steady clock's epoch at which the discovery cache is asked again.
+    std::atomic<int64_t> _recheck = 0;
+    std::mutex           _refreshMtx;
+    // Of the discovery result in use, see ProxyDiscovery::Lookup().
+    uint64_t _generation = 0;
+};
+
+// Periodically probes all proxies in use, concurrently on Factory::Maintenance(), and re-ranks their groups.
+class ProxyProber final
+{
+    ProxyProber() = delete;
+
+public:
+    static void SetInterval(std::chrono::seconds interval);
+
+    // Health record of a proxy, the same for every group using it.
+    static std::shared_ptr<ProxyHealth> Health(const std::string& proxyUrl);
+
+    // Starts probing the group's proxies, the first probe round is run right away.
+    static void Watch(const std::shared_ptr<ProxyGroup>& group);
+
+private:
+    static void Schedule(std::chrono::milliseconds delay);
+    static void ProbeRound();
+    static void ProbeAll(const std::vector<std::shared_ptr<ProxyHealth>>& proxies);
+
+    static std::mutex                              _mtx;
+    static std::vector<std::weak_ptr<ProxyHealth>> _proxies;
+    static std::vector<std::weak_ptr<ProxyGroup>>  _groups;
+    static std::chrono::seconds                    _interval;
+    static bool                                    _scheduled;
+};
+}
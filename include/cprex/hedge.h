@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+#include "budget.h"
+
+namespace cprex
+{
+struct HedgeOptions
+{
+    bool enabled = false;
+
+    // Time to wait for a response before the hedge is sent.
+    // =0 to use the latency percentile of the named session's recent requests instead.
+    std::chrono::milliseconds delay = std::chrono::milliseconds(0);
+    double                    percentile = 0.95;
+
+    // Hedges are paid from a budget filled by every hedgeable request, thus ratio is the share of requests that may
+    // be hedged at most.
+    RetryBudgetOptions budget = {.ratio = 0.05, .minRetriesPerSecond = 1, .maxBalance = 10};
+};
+
+// Hedging state of a named session, shared by all its sessions.
+// Only GET, HEAD and OPTIONS requests are hedged as it must be safe to send them twice.
+class Hedging final
+{
+public:
+    struct Stats
+    {
+        uint64_t requests;
+        // Hedges sent.
+        uint64_t fired;
+        // Hedges answering before the original request.
+        uint64_t won;
+        // Hedges not sent for lack of budget.
+        uint64_t denied;
+    };
+
+    explicit Hedging(const HedgeOptions& options);
+
+    Hedging(const Hedging&)            = delete;
+    Hedging& operator=(const Hedging&) = delete;
+
+    // Starts a hedgeable request, returns the time after which to send its hedge. std::nullopt if it shall not be
+    // hedged as the latency percentile isn't known yet.
+    std::optional<std::chrono::microseconds> Begin();
+
+    // Whether the budget allows to send a hedge now.
+    bool Fire();
+    void Won();
+
+    void RecordLatency(std::chrono::microseconds latency);
+
+    Stats GetStats() const;
+
+private:
+    // Recent latencies, the percentile is recalculated every Samples/4 of them.
+    static constexpr size_t Samples = 256;
+
+    void recalculate();
+
+    const HedgeOptions _options;
+    RetryBudget        _budget;
+
+    std::array<std::atomic<uint32_t>, Samples> _latencies {};
+    std::atomic<uint64_t>                      _recorded = 0;
+    // In microseconds, =0 if not known yet.
+    std::atomic<uint32_t> _percentile = 0;
+
+    std::atomic<uint64_t> _requests = 0;
+    std::atomic<uint64_t> _fired    = 0;
+    std::atomic<uint64_t> _won      = 0;
+    std::atomic<uint64_t> _denied   = 0;
+};
+}
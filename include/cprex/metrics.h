@@ -0,0 +1,142 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "response.h"
+
+namespace cprex
+{
+// HDR style histogram of durations in microseconds. Values below 2^SubBits get a bucket each, above that every power
+// of two range is split into 2^SubBits buckets, so the relative error stays below 1/2^SubBits (~6%) up to 2^MaxBits
+// microseconds (~71 minutes). Larger values count into the last bucket.
+class Histogram final
+{
+public:
+    static constexpr unsigned SubBits = 4;
+    static constexpr unsigned MaxBits = 32;
+    static constexpr size_t   Buckets = (MaxBits - SubBits + 1) << SubBits;
+
+    static size_t BucketOf(uint64_t value);
+    // The smallest value counted into bucket, LowerBound(Buckets) is the first value beyond the range.
+    static uint64_t LowerBound(size_t bucket);
+
+    void Record(uint64_t value)
+    {
+        _counts[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Adds the counts to counts, which has Buckets entries.
+    void AddTo(std::vector<uint64_t>& counts, uint64_t& sum) const;
+
+private:
+    std::array<std::atomic<uint64_t>, Buckets> _counts {};
+    std::atomic<uint64_t>                      _sum = 0;
+};
+
+struct HistogramSnapshot
+{
+    std::vector<uint64_t> counts = std::vector<uint64_t>(Histogram::Buckets);
+    uint64_t              count  = 0;
+    // Of all values in microseconds.
+    uint64_t sum = 0;
+
+    // Upper bound of the bucket holding the percentile (0..1) in microseconds, =0 if empty.
+    uint64_t Percentile(double percentile) const;
+    // Number of values up to and including limit microseconds, counting only buckets entirely below it.
+    uint64_t CountUpTo(uint64_t limit) const;
+};
+
+// Why a failed attempt wasn't retried although its RetryPolicy allowed another one.
+enum class RetryRejection
+{
+    // The circuit breaker opened meanwhile.
+    CircuitOpen,
+    // No token left in the retry budget.
+    BudgetExhausted,
+    Count,
+};
+
+struct MetricsSnapshot
+{
+    uint64_t requests          = 0;
+    uint64_t attempts          = 0;
+    uint64_t retries           = 0;
+    uint64_t retryAfterHonored = 0;
+    uint64_t directFallbacks   = 0;
+    uint64_t newConnections    = 0;
+    uint64_t reusedConnections = 0;
+    // Retries by the status code of the failed attempt, 0 if there was no HTTP response.
+    std::map<long, uint64_t> retriesByStatus;
+    // Retries not made, indexed by RetryRejection.
+    std::array<uint64_t, static_cast<size_t>(RetryRejection::Count)> rejectedRetries {};
+
+    // Whole attempts, and of attempts on a new connection their DNS, TCP connect and TLS handshake phases.
+    HistogramSnapshot total;
+    HistogramSnapshot dns;
+    HistogramSnapshot connect;
+    HistogramSnapshot tls;
+    // Until the first response byte.
+    HistogramSnapshot ttfb;
+
+    double ConnectionReuseRate() const
+    {
+        const uint64_t connections = newConnections + reusedConnections;
+        return connections ? static_cast<double>(reusedConnections) / connections : 0;
+    }
+};
+
+// Request metrics of a named session, shared by all its sessions.
+// Recording is a few relaxed atomic increments on one of several shards, picked per thread, so threads rarely write
+// the same cache lines. Shards are only summed up by Snapshot().
+class Metrics final
+{
+public:
+    Metrics() = default;
+
+    Metrics(const Metrics&)            = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void RecordAttempt(const AttemptInfo& attempt, bool first);
+    // The attempt failed with statusCode and will be repeated, after the server's Retry-After if retryAfter is set.
+    void RecordRetry(long statusCode, bool retryAfter);
+    void RecordRejectedRetry(RetryRejection reason);
+    void RecordDirectFallback();
+
+    MetricsSnapshot Snapshot() const;
+
+    // Prometheus text exposition format of the snapshots by session name.
+    static std::string Prometheus(const std::map<std::string, MetricsSnapshot>& snapshots);
+
+private:
+    static constexpr size_t Shards = 8;
+    // Status codes beyond count as 0.
+    static constexpr size_t StatusCodes = 600;
+
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> requests          = 0;
+        std::atomic<uint64_t> attempts          = 0;
+        std::atomic<uint64_t> retryAfterHonored = 0;
+        std::atomic<uint64_t> directFallbacks   = 0;
+        std::atomic<uint64_t> newConnections    = 0;
+        std::atomic<uint64_t> reusedConnections = 0;
+
+        std::array<std::atomic<uint64_t>, StatusCodes> retriesByStatus {};
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(RetryRejection::Count)> rejectedRetries {};
+
+        Histogram total;
+        Histogram dns;
+        Histogram connect;
+        Histogram tls;
+        Histogram ttfb;
+    };
+
+    Shard& shard();
+
+    std::array<Shard, Shards> _shards;
+};
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "cprex.h"
+
+namespace cprex
+{
+// Runs any number of requests of a named session concurrently on a single curl_multi handle.
+// All transfers are driven by one event loop thread, so the number of requests in flight is not bound to the number
+// of threads. Every request leases its own session from the named session's pool, while connections, TLS sessions
+// and DNS entries are shared via the named session's share handle.
+// Create via Factory::CreateMulti().
+class MultiSession final
+{
+    friend Factory;
+    friend Session;
+
+public:
+    MultiSession(const MultiSession&)            = delete;
+    MultiSession& operator=(const MultiSession&) = delete;
+
+    // Requests still in flight are aborted and complete with an error response.
+    ~MultiSession();
+
+    // Number of requests submitted but not yet completed, including those waiting for a retry.
+    size_t InFlight() const
+    {
+        return _inFlight;
+    }
+
+#ifdef _WIN32
+#    pragma region HTTP verb methods
+#endif
+    // Every verb comes as:
+    // - XXX(ts...)               returning a cprex::AsyncResponse
+    // - XXXCallback(then, ts...) invoking then(cprex::Response) on the event loop thread, so keep it short.
+    // Parameters are identical to the ones of cprex::Session, thus use Path("relative/path") for the URL.
+
+    template <typename... Ts>
+    AsyncResponse Get(Ts&&... ts)
+    {
+        return submit(&Session::PrepareGet, std::forward<Ts>(ts)...);
+    }
+    template <typename Then, typename... Ts>
+    void GetCallback(Then then, Ts&&... ts)
+    {
+        submitCallback(&Session::PrepareGet, std::move(then), std::forward<Ts>(ts)...);
+    }
+
+    template <typename... Ts>
+    AsyncResponse Post(Ts&&... ts)
+    {
+        return submit(&Session::PreparePost, std::forward<Ts>(ts)...);
+    }
+    template <typename Then, typename... Ts>
+    void PostCallback(Then then, Ts&&... ts)
+    {
+        submitCallback(&Session::PreparePost, std::move(then), std::forward<Ts>(ts)...);
+    }
+
+    template <typename... Ts>
+    AsyncResponse Put(Ts&&... ts)
+    {
+        return submit(&Session::PreparePut, std::forward<Ts>(ts)...);
+    }
+    template <typename Then, typename... Ts>
+    void PutCallback(Then then, Ts&&... ts)
+    {
+        submitCallback(&Session::PreparePut, std::move(then), std::forward<Ts>(ts)...);
+    }
+
+    template <typename... Ts>
+    AsyncResponse Head(Ts&&... ts)
+    {
+        return submit(&Session::PrepareHead, std::forward<Ts>(ts)...);
+    }
+    template <typename Then, typename... Ts>
+    void HeadCallback(Then then, Ts&&... ts)
+    {
+        submitCallback(&Session::PrepareHead, std::move(then), std::forward<Ts>(ts)...);
+    }
+
+    template <typename... Ts>
+    AsyncResponse Delete(Ts&&... ts)
+    {
+        return submit(&Session::PrepareDelete, std::forward<Ts>(ts)...);
+    }
+    template <typename Then, typename... Ts>
+    void DeleteCallback(Then then, Ts&&... ts)
+    {
+        submitCallback(&Session::PrepareDelete, std::move(then), std::forward<Ts>(ts)...);
+    }
+
+    template <typename... Ts>
+    AsyncResponse Options(Ts&&... ts)
+    {
+        return submit(&Session::PrepareOptions, std::forward<Ts>(ts)...);
+    }
+    template <typename Then, typename... Ts>
+    void OptionsCallback(Then then, Ts&&... ts)
+    {
+        submitCallback(&Session::PrepareOptions, std::move(then), std::forward<Ts>(ts)...);
+    }
+
+    template <typename... Ts>
+    AsyncResponse Patch(Ts&&... ts)
+    {
+        return submit(&Session::PreparePatch, std::forward<Ts>(ts)...);
+    }
+    template <typename Then, typename... Ts>
+    void PatchCallback(Then then, Ts&&... ts)
+    {
+        submitCallback(&Session::PreparePatch, std::move(then), std::forward<Ts>(ts)...);
+    }
+#ifdef _WIN32
+#    pragma endregion
+#endif
+
+private:
+    using Done = std::function<void(Response)>;
+
+    struct Transfer
+    {
+        SessionLease lease;
+        RetryState   retryState;
+        Done         done;
+    };
+
+    // Handed over from submitting threads and the retry scheduler to the event loop.
+    // Shared with parked retries as they may become due after the MultiSession is gone.
+    struct Inbox
+    {
+        std::mutex                             mtx;
+        bool                                   closed = false;
+        CURLM*                                 multi  = nullptr;
+        std::vector<std::unique_ptr<Transfer>> submitted;
+        std::vector<Transfer*>                 due;
+    };
+
+    MultiSession(std::string name, bool trace);
+
+    template <typename... Ts>
+    AsyncResponse submit(void (Session::*prepper)(), Ts&&... ts)
+    {
+        auto promise = std::make_shared<std::promise<Response>>();
+        auto future  = promise->get_future();
+        submitCallback(prepper, [promise](Response r) { promise->set_value(std::move(r)); }, std::forward<Ts>(ts)...);
+        return AsyncResponse {std::move(future)};
+    }
+
+    template <typename Then, typename... Ts>
+    void submitCallback(void (Session::*prepper)(), Then then, Ts&&... ts)
+    {
+        auto transfer  = newTransfer(Factory::AcquireSession(_name));
+        transfer->done = Done(std::move(then));
+        transfer->lease->set_option(std::forward<Ts>(ts)...);
+        transfer->lease->_prepper = prepper;
+        enqueue(std::move(transfer));
+    }
+
+    std::unique_ptr<Transfer> newTransfer(SessionLease lease);
+    void                      enqueue(std::unique_ptr<Transfer> transfer);
+    // Runs the request lease is prepared for, the session may be of another named session.
+    void enqueue(SessionLease lease, Done done);
+
+    void run();
+    void park(Transfer* transfer, std::chrono::milliseconds wait);
+    void start(Transfer* transfer);
+    void complete(Transfer* transfer, CURLcode curl_error);
+    void abortAll();
+
+    const std::string _name;
+    const bool        _trace;
+
+    CURLM*              _multi;
+    std::atomic<bool>   _stop     = false;
+    std::atomic<size_t> _inFlight = 0;
+
+    std::shared_ptr<Inbox> _inbox;
+
+    // Owned by the event loop thread only, includes the transfers parked for a retry.
+    std::unordered_map<Transfer*, std::unique_ptr<Transfer>> _transfers;
+
+    std::thread _loop;
+};
+}
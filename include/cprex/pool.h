@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cprex
+{
+class Session;
+class SessionPool;
+
+struct PoolOptions
+{
+    // Sessions created on the first lease and never evicted. Not up front, as creating them waits for the proxy
+    // discovery.
+    size_t minSize = 0;
+
+    // Sessions returned while this many are idle already get destroyed.
+    size_t maxSize = 16;
+
+    // Idle sessions exceeding minSize are evicted after this time.
+    std::chrono::seconds idleTimeout = std::chrono::seconds(60);
+};
+
+// RAII lease on a pooled Session, hands it back to its pool on destruction.
+class SessionLease final
+{
+    friend SessionPool;
+
+public:
+    SessionLease() = default;
+    SessionLease(SessionLease&& other) noexcept;
+    SessionLease& operator=(SessionLease&& other) noexcept;
+    ~SessionLease();
+
+    Session* operator->() const
+    {
+        return _session.get();
+    }
+    Session& operator*() const
+    {
+        return *_session;
+    }
+    explicit operator bool() const
+    {
+        return !!_session;
+    }
+
+private:
+    SessionLease(std::shared_ptr<SessionPool> pool, std::unique_ptr<Session> session);
+
+    std::shared_ptr<SessionPool> _pool;
+    std::unique_ptr<Session>     _session;
+};
+
+// Keeps configured sessions of one named config for reuse, so a request doesn't pay for creating an easy handle,
+// copying the config and probing proxies.
+class SessionPool final : public std::enable_shared_from_this<SessionPool>
+{
+    friend SessionLease;
+
+public:
+    using Create = std::function<std::unique_ptr<Session>()>;
+    // Brings a returned session back to its baseline config, returns false if it can't be reused.
+    using Reset = std::function<bool(Session&)>;
+
+    SessionPool(Create create, Reset reset, PoolOptions options);
+    ~SessionPool();
+
+    SessionPool(const SessionPool&)            = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+
+    // The first call fills the pool.
+    SessionLease Acquire();
+
+    // Creates sessions until minSize are idle.
+    void Fill();
+
+    size_t Idle() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct IdleSession
+    {
+        Clock::time_point        since;
+        std::unique_ptr<Session> session;
+    };
+
+    void release(std::unique_ptr<Session> session);
+    // Moves sessions idle for too long into evicted, which the caller destroys outside the lock.
+    void evict(Clock::time_point now, std::vector<std::unique_ptr<Session>>& evicted);
+
+    const Create _create;
+    const Reset  _reset;
+    PoolOptions  _options;
+
+    std::once_flag     _filled;
+    mutable std::mutex _mtx;
+    // Most recently returned at the back, which is also where sessions are acquired from to keep them warm.
+    std::vector<IdleSession> _idle;
+};
+}
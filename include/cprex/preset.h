@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include <cpr/cpr.h> // https://github.com/libcpr/cpr
+
+namespace cprex
+{
+struct HeaderListDeleter
+{
+    void operator()(curl_slist* list) const
+    {
+        curl_slist_free_all(list);
+    }
+};
+using HeaderList = std::unique_ptr<curl_slist, HeaderListDeleter>;
+
+// The headers and query parameters of a named session as given to Factory::PrepareSession(), encoded once and shared
+// read-only by all its sessions. Without per-request headers the header list is handed to libcurl as is, instead of
+// cpr building and freeing a new one for every request attempt.
+class RequestPreset final
+{
+public:
+    RequestPreset(const cpr::Header& header, const cpr::Parameters& parameters);
+
+    RequestPreset(const RequestPreset&)            = delete;
+    RequestPreset& operator=(const RequestPreset&) = delete;
+
+    curl_slist* Headers() const
+    {
+        return _headers.get();
+    }
+
+    // URL encoded, without the leading '?'.
+    const std::string& Query() const
+    {
+        return _query;
+    }
+
+    // Headers of overlay followed by the preset ones not overridden by overlay.
+    HeaderList Merge(const cpr::Header& overlay) const;
+
+private:
+    static HeaderList append(HeaderList list, const std::string& line);
+
+    const cpr::Header _header;
+    HeaderList        _headers;
+    std::string       _query;
+};
+}
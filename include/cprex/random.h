@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+
+namespace cprex
+{
+// Fast pseudo random numbers with one generator per thread, thus no locking and no shared state like rand().
+// Not suitable for anything security related.
+namespace Random
+{
+uint64_t Next();
+
+// Uniformly distributed in [0, 1).
+double NextDouble();
+
+// Scrambles bits of a hash, e.g. to combine keys (splitmix64 finalizer).
+uint64_t Mix(uint64_t x);
+}
+}
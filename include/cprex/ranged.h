@@ -0,0 +1,89 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "file.h"
+#include "response.h"
+
+namespace cprex
+{
+class Session;
+
+struct DownloadProgress
+{
+    // =0 if the server didn't tell the size.
+    uint64_t                  total;
+    uint64_t                  received;
+    std::chrono::milliseconds elapsed;
+    double                    bytesPerSecond;
+    // Ranges fetched concurrently, 1 if the server doesn't support ranges.
+    size_t ranges;
+};
+
+struct RangedDownloadOptions
+{
+    // Ranges fetched concurrently at most, each over its own connection.
+    size_t connections = 4;
+
+    // Files are only split into ranges of at least this size.
+    uint64_t minRangeSize = 8 * 1024 * 1024;
+
+    // Called from the downloading thread every progressInterval and once when done.
+    std::function<void(const DownloadProgress&)> progress;
+    std::chrono::milliseconds                    progressInterval = std::chrono::milliseconds(500);
+};
+
+// Engine behind Session::DownloadFile(): asks for Content-Length and Accept-Ranges via HEAD, then fetches N ranges
+// concurrently on pooled sessions driven by a single curl_multi handle, writing each at its offset into the
+// preallocated file. A failed range is retried according to the RetryPolicy from where it stopped.
+class RangedDownload final
+{
+public:
+    RangedDownload(Session& session, const cpr::fs::path& path, const RangedDownloadOptions& options,
+        std::function<void(Session&)> setOptions);
+
+    ~RangedDownload();
+
+    RangedDownload(const RangedDownload&)            = delete;
+    RangedDownload& operator=(const RangedDownload&) = delete;
+
+    // Made of the attempts of the HEAD and of all ranges, in this order.
+    Response Run();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Range;
+
+    // HEAD for the size and whether ranges are supported.
+    Response probe();
+    void     split();
+
+    // Starts the next attempt of range, false if rejected by the circuit breaker.
+    bool start(Range& range);
+    void attach(Range& range);
+    void report(bool force);
+    // Completes the download with the response of range, which gets the attempts of the HEAD and all ranges.
+    Response complete(Range& range, CURLcode curl_error);
+
+    static size_t write(char* ptr, size_t size, size_t nmemb, void* userdata);
+
+    Session&                      _session;
+    const RangedDownloadOptions   _options;
+    std::function<void(Session&)> _setOptions;
+    File                          _file;
+    CURLM*                        _multi = nullptr;
+
+    bool                                _resumable = false;
+    AttemptLog                          _probeAttempts;
+    std::vector<std::unique_ptr<Range>> _ranges;
+
+    const Clock::time_point _started = Clock::now();
+    Clock::time_point       _reported;
+    std::optional<uint64_t> _total;
+    uint64_t                _received = 0;
+};
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ares.h> // https://c-ares.org
+#include <curl/curl.h>
+
+namespace cprex
+{
+struct DnsOptions
+{
+    // Comma separated "ip[:port]" as for CURLOPT_DNS_SERVERS, e.g. "10.0.0.2,10.0.0.3:5353".
+    // Empty to use the system's resolver configuration, which keeps split-horizon DNS working.
+    std::string servers;
+    // Resolves the named session's hosts ahead of its requests, see HostResolver.
+    bool preResolve = true;
+    // Bounds of the record's TTL, addresses are refreshed once refreshAt of it passed.
+    std::chrono::seconds minTtl    = std::chrono::seconds(5);
+    std::chrono::seconds maxTtl    = std::chrono::seconds(300);
+    double               refreshAt = 0.75;
+};
+
+// Resolves the hosts of a named session with c-ares in the background and refreshes them before their TTL expires.
+// Sessions hand the addresses to libcurl via CURLOPT_RESOLVE, so their requests don't wait for DNS once the first
+// lookup finished. Until then libcurl resolves a host itself. Addresses are kept if a refresh fails.
+class HostResolver final : public std::enable_shared_from_this<HostResolver>
+{
+public:
+    explicit HostResolver(const DnsOptions& options);
+    // Pending lookups are cancelled.
+    ~HostResolver();
+
+    HostResolver(const HostResolver&)            = delete;
+    HostResolver& operator=(const HostResolver&) = delete;
+
+    // Starts resolving host unless it's watched already or an IP address.
+    void Watch(std::string_view host, uint16_t port);
+
+    // Incremented whenever Current() changes, so sessions only fetch it if needed.
+    uint64_t Generation() const
+    {
+        return _generation.load(std::memory_order_acquire);
+    }
+    // "host:port:address,..." entries of all hosts resolved so far, =nullptr if none. Replaced, never modified.
+    std::shared_ptr<curl_slist> Current() const;
+
+private:
+    struct Host
+    {
+        std::string              name;
+        uint16_t                 port;
+        std::vector<std::string> addresses;
+    };
+    // Passed through c-ares as the lookup's argument.
+    struct Lookup
+    {
+        std::weak_ptr<HostResolver> resolver;
+        size_t                      host;
+    };
+
+    void        resolve(size_t host);
+    static void resolved(void* arg, int status, int timeouts, ares_addrinfo* result);
+    void        refresh(size_t host, std::chrono::seconds delay);
+    // Rebuilds the list, called with _mtx held.
+    void publish();
+
+    const DnsOptions _options;
+    ares_channel_t*  _channel = nullptr;
+
+    mutable std::mutex          _mtx;
+    std::vector<Host>           _hosts;
+    std::shared_ptr<curl_slist> _current;
+    std::atomic<uint64_t>       _generation = 0;
+};
+}
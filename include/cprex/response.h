@@ -0,0 +1,97 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cpr/cpr.h> // https://github.com/libcpr/cpr
+
+namespace cprex
+{
+// One attempt of a request, its phases as measured by libcurl.
+struct AttemptInfo
+{
+    // Of the attempt, DNS, TCP connect and TLS handshake are =0 if it reused a cached connection.
+    std::chrono::microseconds total {};
+    std::chrono::microseconds dns {};
+    std::chrono::microseconds connect {};
+    std::chrono::microseconds tls {};
+    // Until the first response byte, =0 without response.
+    std::chrono::microseconds ttfb {};
+    bool                      reused = false;
+
+    // Empty if sent direct.
+    std::string proxy;
+    long        statusCode = 0;
+    CURLcode    error      = CURLE_OK;
+
+    // Before the next attempt, =0 for the last one. Either the server's Retry-After or the backoff policy's delay.
+    std::chrono::milliseconds wait {};
+    bool                      retryAfter = false;
+
+    // Reads the timings, status code and error of the finished attempt.
+    static AttemptInfo Read(CURL* curl, CURLcode error);
+};
+using AttemptLog = std::vector<AttemptInfo>;
+
+// cpr::Response of a cprex::Session, along with the attempts it took.
+struct Response : cpr::Response
+{
+    Response() = default;
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    Response(cpr::Response response) : cpr::Response(std::move(response))
+    {
+    }
+
+    // Empty if the request was rejected before its first attempt, e.g. by an open circuit breaker.
+    AttemptLog attempts;
+};
+using AsyncResponse = cpr::AsyncWrapper<Response>;
+
+struct SlowRequestOptions
+{
+    // Requests taking longer, including the waits between attempts, are kept. =0 to keep none.
+    std::chrono::milliseconds threshold = std::chrono::milliseconds(0);
+    // The oldest ones are dropped beyond.
+    size_t capacity = 64;
+};
+
+struct SlowRequest
+{
+    std::chrono::system_clock::time_point finished;
+    std::chrono::microseconds             elapsed;
+    std::string                           url;
+    long                                  statusCode;
+    cpr::Error                            error;
+    cpr::Header                           header;
+    AttemptLog                            attempts;
+};
+
+// The most recent slow requests of a named session, shared by all its sessions.
+// Only requests above the threshold take the lock, all others just compare their duration.
+class SlowRequestLog final
+{
+public:
+    explicit SlowRequestLog(const SlowRequestOptions& options);
+
+    SlowRequestLog(const SlowRequestLog&)            = delete;
+    SlowRequestLog& operator=(const SlowRequestLog&) = delete;
+
+    // Keeps response if elapsed exceeds the threshold.
+    void Record(const Response& response, std::chrono::microseconds elapsed);
+
+    // Oldest first.
+    std::vector<SlowRequest> Snapshot() const;
+
+    // Human readable, one line per request followed by one per attempt.
+    static std::string Format(const std::vector<SlowRequest>& requests);
+
+private:
+    const SlowRequestOptions _options;
+
+    mutable std::mutex       _mtx;
+    std::vector<SlowRequest> _requests;
+    // Next slot to overwrite once full.
+    size_t _next = 0;
+};
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace cprex
+{
+// Min-heap of timers run by a single thread.
+// Used to park requests until their next retry attempt is due, so a waiting request costs a heap entry rather than a
+// blocked thread. Tasks run on the scheduler thread and thus shall only hand the actual work over to someone else.
+class Scheduler final
+{
+public:
+    using Task = std::function<void()>;
+
+    Scheduler();
+    // Tasks not yet due are dropped without being run.
+    ~Scheduler();
+
+    Scheduler(const Scheduler&)            = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    void Schedule(std::chrono::milliseconds delay, Task task);
+
+    // Number of tasks waiting to become due.
+    size_t Pending() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer
+    {
+        Clock::time_point due;
+        // Keeps tasks with identical due time in FIFO order.
+        uint64_t seq;
+        Task     task;
+
+        bool operator>(const Timer& other) const
+        {
+            return due > other.due || (due == other.due && seq > other.seq);
+        }
+    };
+
+    void run();
+
+    mutable std::mutex                                                   _mtx;
+    std::condition_variable                                              _cv;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> _timers;
+    uint64_t                                                             _seq  = 0;
+    bool                                                                 _stop = false;
+    std::thread                                                          _thread;
+};
+}
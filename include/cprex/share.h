@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+
+#include <curl/curl.h>
+
+namespace cprex
+{
+// Owns a curl share handle holding the cookie, DNS and TLS session caches of a named session and makes it usable by
+// sessions on many threads at once.
+// There's one lock per curl_lock_data kind, so e.g. a DNS lookup doesn't wait for the TLS session cache. Where libcurl
+// asks for CURL_LOCK_ACCESS_SHARED the lock is taken shared.
+// The connection cache isn't shared, libcurl doesn't support that between threads performing transfers at the same
+// time, see https://curl.se/libcurl/c/CURLSHOPT_SHARE.html. Pooled sessions keep their connections instead, and new
+// ones are cheaper thanks to the shared DNS cache and TLS session resumption.
+class Share final
+{
+public:
+    Share();
+    ~Share();
+
+    Share(const Share&)            = delete;
+    Share& operator=(const Share&) = delete;
+
+    CURLSH* Handle() const
+    {
+        return _share;
+    }
+
+    struct LockStats
+    {
+        uint64_t acquired;
+        // Acquisitions which had to wait for another thread.
+        uint64_t contended;
+    };
+
+    // Counting costs an extra try_lock per acquisition, thus it's off by default.
+    void CountContention(bool enable)
+    {
+        _countContention = enable;
+    }
+    LockStats Stats(curl_lock_data data) const;
+
+private:
+    static void lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlock(CURL* handle, curl_lock_data data, void* userptr);
+
+    struct Lock
+    {
+        std::shared_mutex            mtx;
+        // libcurl's unlock callback doesn't tell the access mode, an exclusive lock is recognized by its owner.
+        std::atomic<std::thread::id> owner;
+        std::atomic<uint64_t>        acquired  = 0;
+        std::atomic<uint64_t>        contended = 0;
+    };
+
+    CURLSH*                                _share;
+    std::atomic<bool>                      _countContention = false;
+    std::array<Lock, CURL_LOCK_DATA_LAST> _locks;
+};
+}
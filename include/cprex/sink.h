@@ -0,0 +1,105 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "file.h"
+
+namespace cprex
+{
+class Session;
+
+struct FileSinkOptions
+{
+    enum class Mode
+    {
+        // Batches of bufferSize written via pwrite() from a buffer taken from a process wide pool.
+        Buffered,
+        // Copied straight into windows of mapSize mapped from the file.
+        Mapped,
+    };
+    Mode mode = Mode::Buffered;
+
+    size_t bufferSize = 1024 * 1024;
+    size_t mapSize    = 64 * 1024 * 1024;
+
+    enum class Sync
+    {
+        // Left to the operating system.
+        None,
+        OnClose,
+        // Every syncInterval bytes and on close, limits the dirty pages piling up for huge files.
+        Periodic,
+    };
+    Sync     sync         = Sync::None;
+    uint64_t syncInterval = 256 * 1024 * 1024;
+};
+
+// Download target bypassing iostreams: data is written in large batches or via memory mappings, and the file is
+// preallocated once Content-Length is known. Every request attempt starts over at the beginning of the file.
+// Bodies of non 2xx responses are dropped.
+// Use via Session::Download(FileSink&, ...) or Session::DownloadAsync(path, ...).
+class FileSink final
+{
+    friend Session;
+
+public:
+    FileSink(const cpr::fs::path& path, const FileSinkOptions& options = {});
+    // Closes unless already done.
+    ~FileSink();
+
+    FileSink(const FileSink&)            = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    // Writes what's buffered, trims the file to the size written and syncs according to the policy.
+    void Close();
+
+    uint64_t Written() const
+    {
+        return _written;
+    }
+
+private:
+    using Buffer = std::unique_ptr<char[]>;
+
+    // Installs the write callback once the session has been prepared for the next attempt.
+    void attach(CURL* curl);
+
+    void write(const char* data, size_t size);
+    void flush();
+    void map(uint64_t offset);
+    void unmap();
+    // Syncs according to the policy.
+    void written(uint64_t bytes);
+
+    static size_t writeCallback(char* ptr, size_t size, size_t nmemb, void* userdata);
+
+    // Idle buffers of all sinks, buffers of other sizes than requested are dropped.
+    static Buffer acquireBuffer(size_t size);
+    static void   releaseBuffer(Buffer buffer, size_t size);
+
+    static std::mutex          _poolMtx;
+    static std::vector<Buffer> _pool;
+    static size_t              _poolBufferSize;
+
+    const FileSinkOptions _options;
+    File                  _file;
+    CURL*                 _curl   = nullptr;
+    bool                  _closed = false;
+
+    std::optional<bool> _accepted;
+    uint64_t            _written   = 0;
+    uint64_t            _allocated = 0;
+    uint64_t            _unsynced  = 0;
+
+    // Buffered mode, _used bytes pending to be written at _written - _used.
+    Buffer _buffer;
+    size_t _used = 0;
+
+    // Mapped mode, _mapped bytes mapped at _mapOffset.
+    char*    _mapping   = nullptr;
+    uint64_t _mapOffset = 0;
+    size_t   _mapped    = 0;
+};
+}
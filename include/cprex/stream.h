@@ -0,0 +1,138 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <cpr/cpr.h> // https://github.com/libcpr/cpr
+
+#include "response.h"
+
+namespace cprex
+{
+class Session;
+
+struct StreamOptions
+{
+    // Size of every chunk handed out, at least 16KiB, the most libcurl hands over at once.
+    size_t chunkSize = 64 * 1024;
+
+    // Chunks per request. Once all are filled and not yet released by the consumer, the transfer is paused.
+    size_t chunks = 4;
+};
+
+// Fixed number of equally sized buffers owned by a single streamed request.
+class ChunkPool final
+{
+public:
+    explicit ChunkPool(const StreamOptions& options);
+
+    ChunkPool(const ChunkPool&)            = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    size_t ChunkSize() const
+    {
+        return _chunkSize;
+    }
+
+    // nullptr if all chunks are in use.
+    std::unique_ptr<char[]> Acquire();
+    void                    Release(std::unique_ptr<char[]> buffer);
+    size_t                  Available() const;
+
+private:
+    const size_t _chunkSize;
+    const size_t _chunks;
+
+    mutable std::mutex                   _mtx;
+    size_t                               _allocated = 0;
+    std::vector<std::unique_ptr<char[]>> _free;
+};
+
+// A piece of a streamed response body. Its buffer goes back to the request's ChunkPool on destruction, so keep it
+// only as long as needed.
+class Chunk final
+{
+public:
+    Chunk(std::shared_ptr<ChunkPool> pool, std::unique_ptr<char[]> buffer, size_t size);
+    Chunk(Chunk&& other) noexcept            = default;
+    Chunk& operator=(Chunk&& other) noexcept = default;
+    ~Chunk();
+
+    std::string_view View() const
+    {
+        return {_buffer.get(), _size};
+    }
+
+private:
+    std::shared_ptr<ChunkPool> _pool;
+    std::unique_ptr<char[]>    _buffer;
+    size_t                     _size;
+};
+
+// Consumer side of a request whose body is streamed instead of being accumulated in cpr::Response::text.
+// The request runs on a session leased from the named session's pool, driven by the single Factory::Streams() event
+// loop, so a transfer paused for a slow consumer holds no thread. Failures before any part of the body was handed out
+// are retried as usual, later ones end the stream. Bodies of non 2xx responses aren't streamed but kept in Response().text.
+// Destroying the stream cancels the request.
+class BodyStream final
+{
+    friend Session;
+
+public:
+    BodyStream(BodyStream&& other) noexcept            = default;
+    BodyStream& operator=(BodyStream&& other) noexcept = default;
+    ~BodyStream();
+
+    // Blocks for the next chunk, std::nullopt once the body is complete.
+    std::optional<Chunk> Next();
+
+    // Blocks until the request is done. The text is empty if the body went through Next().
+    cprex::Response Response();
+
+private:
+    struct State
+    {
+        explicit State(const StreamOptions& options) : pool(std::make_shared<ChunkPool>(options))
+        {
+        }
+
+        std::shared_ptr<ChunkPool> pool;
+
+        std::mutex                     mtx;
+        std::condition_variable        cv;
+        std::deque<Chunk>              ready;
+        bool                           done = false;
+        std::optional<cprex::Response> response;
+        std::atomic<bool>              cancelled = false;
+
+        // Producer side, only touched by the Factory::Streams() event loop.
+        Session*                session = nullptr;
+        CURL*                   curl    = nullptr;
+        std::optional<bool>     accepted;
+        bool                    paused = false;
+        // Data arrived since the last progress callback.
+        bool                    wrote = false;
+        std::unique_ptr<char[]> buffer;
+        size_t                  used = 0;
+        // Body of a non 2xx response, which isn't handed out.
+        std::string rejected;
+    };
+
+    explicit BodyStream(const StreamOptions& options);
+
+    // Installs the write and progress callbacks once the session has been prepared for the next attempt.
+    static void attach(const std::shared_ptr<State>& state, Session& session);
+    static void finish(const std::shared_ptr<State>& state, cprex::Response response);
+
+    static void   publish(State& state);
+    static size_t write(char* ptr, size_t size, size_t nmemb, void* userdata);
+    static int    progress(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t);
+
+    std::shared_ptr<State> _state;
+};
+}
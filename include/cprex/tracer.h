@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cpr/cpr.h> // https://github.com/libcpr/cpr
+
+namespace cprex
+{
+// Sizes of the per thread rings, each event takes about 40 bytes plus maxSessionName and maxData.
+struct TraceOptions
+{
+    // Bytes of header, body and text data kept per event, the rest is only counted.
+    size_t maxData = 176;
+    // Longer session names are cut.
+    size_t maxSessionName = 22;
+    // Events a thread may record before the writer drained them, further ones are dropped.
+    size_t ringSize = 1024;
+};
+
+// Collects libcurl's debug output of traced requests as typed events and writes them as JSON lines, one per event:
+// {"time":<us since epoch>,"session":"<name>","request":<trace id>,"attempt":<n>,"type":"header_out","size":<bytes>,
+//  "data":"<up to TraceOptions::maxData bytes>","truncated":true}
+// Recording copies the event into a lock-free ring of the calling thread, a background thread drains all rings and
+// writes them in one go every flush interval. Events are dropped rather than blocking the transfer if a ring is full.
+// TLS payloads are only counted. Use Factory::Tracing(), requests are picked via SessionOptions::traceSampleRate.
+class Tracer final
+{
+public:
+    Tracer() = default;
+    // Writes what's left.
+    ~Tracer();
+
+    Tracer(const Tracer&)            = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Appends to path instead of writing to stderr.
+    void Open(const cpr::fs::path& path);
+    void SetFlushInterval(std::chrono::milliseconds interval);
+    // Threads get new rings of these sizes on their next event.
+    void SetOptions(const TraceOptions& options);
+
+    // A new trace id for about rate (0..1) of the calls, =0 if not to be traced.
+    static uint64_t Sample(double rate);
+
+    // Called from libcurl's debug callback on the thread performing the transfer.
+    void Record(const std::string& session, uint64_t request, uint32_t attempt, curl_infotype type,
+        const char* data, size_t size);
+
+    struct Stats
+    {
+        uint64_t written;
+        // Lost as the ring of the recording thread was full.
+        uint64_t dropped;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Event
+    {
+        int64_t       time;
+        uint64_t      request;
+        uint32_t      attempt;
+        uint32_t      size;
+        uint32_t      kept;
+        curl_infotype type;
+        uint32_t      sessionLength;
+    };
+
+    // Single producer, the thread owning it, and a single consumer, the writer thread.
+    struct Ring
+    {
+        explicit Ring(const TraceOptions& options);
+
+        // Session name and data of event index.
+        char* Session(size_t index)
+        {
+            return payload.get() + index * (maxSessionName + maxData);
+        }
+        char* Data(size_t index)
+        {
+            return Session(index) + maxSessionName;
+        }
+
+        const size_t size;
+        const size_t maxSessionName;
+        const size_t maxData;
+
+        std::vector<Event> events;
+        // maxSessionName + maxData bytes per event, allocated once.
+        std::unique_ptr<char[]> payload;
+        // Next to be written by the producer and read by the consumer.
+        alignas(64) std::atomic<uint64_t> head = 0;
+        alignas(64) std::atomic<uint64_t> tail = 0;
+        // The producer thread exited, removed once drained.
+        std::atomic<bool> closed = false;
+    };
+
+    // The calling thread's ring, registered and the writer started on first use.
+    Ring& ring();
+    void  run();
+    // Formats the events of all rings into out, returns their number.
+    size_t drain(std::string& out);
+    // Drains and writes them in one go, out is reused as buffer.
+    void flush(std::string& out);
+
+    mutable std::mutex                 _mtx;
+    std::condition_variable            _cv;
+    std::vector<std::shared_ptr<Ring>> _rings;
+    TraceOptions                       _options;
+    // Bumped by SetOptions(), so threads replace their rings.
+    std::atomic<uint32_t> _optionsVersion = 0;
+    FILE*                              _file     = nullptr;
+    std::chrono::milliseconds          _interval = std::chrono::milliseconds(200);
+    bool                               _stop     = false;
+    std::thread                        _thread;
+
+    std::atomic<uint64_t> _written = 0;
+    std::atomic<uint64_t> _dropped = 0;
+};
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "file.h"
+
+namespace cprex
+{
+class Session;
+
+// Request body fed to libcurl via its read callback instead of being copied into a cpr::Body first.
+// Pass it like a cpr::Body to Post(), Put() or Patch(). The source is rewound for every attempt. Copies share the data
+// and the read position, so a source serves one request at a time.
+// A session holding an upload stays reusable by a SessionPool as the read callback is removed once done.
+class UploadSource final
+{
+    friend Session;
+
+public:
+    UploadSource() = default;
+
+    // Read straight from the file at explicit offsets into libcurl's upload buffer, so the memory used doesn't grow
+    // with the file size. The file's size is taken once here and must not change until the upload is done.
+    static UploadSource FromFile(const cpr::fs::path& path);
+
+    // Gathered from the buffers in order without joining them. The caller keeps the memory alive until the request
+    // completes.
+    static UploadSource FromBuffers(std::vector<std::string_view> buffers);
+
+    uint64_t Size() const
+    {
+        return _state ? _state->size : 0;
+    }
+
+    explicit operator bool() const
+    {
+        return _state != nullptr;
+    }
+
+private:
+    struct State
+    {
+        uint64_t size     = 0;
+        uint64_t position = 0;
+
+        std::unique_ptr<File> file;
+
+        std::vector<std::string_view> buffers;
+        // Offset of buffers[i] in the body, for seeking.
+        std::vector<uint64_t> offsets;
+        // Index of the buffer holding position.
+        size_t current = 0;
+    };
+
+    // Sets the read and seek callbacks once the session has been prepared for the next attempt, starting over at 0.
+    void        attach(CURL* curl);
+    static void detach(CURL* curl);
+
+    static size_t read(State& state, char* buffer, size_t size);
+    static bool   seek(State& state, uint64_t offset);
+
+    static size_t readCallback(char* buffer, size_t size, size_t nitems, void* userdata);
+    static int    seekCallback(void* userdata, curl_off_t offset, int origin);
+
+    std::shared_ptr<State> _state;
+};
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace cprex
+{
+// A URL split once into its components "scheme://[user[:password]@]host[:port][/path][?query]", which are kept as
+// offsets into the URL so looking them up neither scans nor copies it again.
+// Not a full RFC 3986 parser, just enough for the base URLs of named sessions and proxy URLs.
+class ParsedUrl final
+{
+public:
+    ParsedUrl() = default;
+    explicit ParsedUrl(std::string url);
+
+    const std::string& Str() const
+    {
+        return _url;
+    }
+
+    // Empty if the URL has none, e.g. "host:port" proxies.
+    std::string_view Scheme() const
+    {
+        return part(0, _schemeEnd);
+    }
+    std::string_view User() const
+    {
+        return part(_userBegin, _userEnd);
+    }
+    std::string_view Password() const
+    {
+        return part(_passwordBegin, _passwordEnd);
+    }
+    // Whether there's a "user:password@", as proxy authentication takes both.
+    bool HasCredentials() const
+    {
+        return _userEnd < _passwordBegin;
+    }
+    std::string_view Host() const
+    {
+        return part(_hostBegin, _hostEnd);
+    }
+    // The explicit one or the scheme's default, =0 if neither is known.
+    uint16_t Port() const
+    {
+        return _port;
+    }
+    // Everything after the authority including query and fragment, may be empty.
+    std::string_view Path() const
+    {
+        return part(_pathBegin, _url.size());
+    }
+
+private:
+    std::string_view part(size_t begin, size_t end) const
+    {
+        return std::string_view(_url).substr(begin, end - begin);
+    }
+
+    std::string _url;
+
+    size_t   _schemeEnd     = 0;
+    size_t   _userBegin     = 0;
+    size_t   _userEnd       = 0;
+    size_t   _passwordBegin = 0;
+    size_t   _passwordEnd   = 0;
+    size_t   _hostBegin     = 0;
+    size_t   _hostEnd       = 0;
+    size_t   _pathBegin     = 0;
+    uint16_t _port          = 0;
+};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace cprex
+{
+struct WarmupOptions
+{
+    // Connections opened to the base URL by Factory::PrepareSession(), or through the proxy its sessions picked.
+    // =0 to open none.
+    size_t connections = 0;
+
+    // They are used again every interval so neither libcurl (CURLOPT_MAXAGE_CONN, 118s) nor intermediaries close
+    // them for being idle. Keep it below the shortest idle timeout on the way.
+    std::chrono::seconds interval = std::chrono::seconds(30);
+
+    // A round's requests still running after this are cancelled, the ones not started yet skipped.
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(5000);
+};
+
+// Opens connections of a named session up front and keeps them alive, so the first requests after a deploy or a quiet
+// period don't pay for TCP, TLS and proxy CONNECT.
+// Every round sends a HEAD request for the base URL on each of that many pooled sessions, one after the other, so each
+// opens a connection it keeps or reuses the one it has. Once the server turned out to speak HTTP/2, rounds only let
+// libcurl PING the sessions' connections via curl_easy_upkeep().
+// Rounds run on Factory::Maintenance() and bypass retries, metrics and proxy health. They send no requests while the
+// circuit breaker isn't closed.
+class ConnectionWarmer final : public std::enable_shared_from_this<ConnectionWarmer>
+{
+public:
+    struct Stats
+    {
+        uint64_t rounds;
+        // Requests of the last round answered by the server, i.e. connections known to be open.
+        size_t warm;
+        // Connections the keep-alive rounds had to open again, as they were closed meanwhile.
+        uint64_t reopened;
+        // Whether rounds only PING the HTTP/2 connection.
+        bool multiplexed;
+        // Sessions idle in the named session's pool, filled in by Factory::WarmupStats().
+        size_t idleSessions;
+    };
+
+    ConnectionWarmer(std::string name, const WarmupOptions& options);
+
+    ConnectionWarmer(const ConnectionWarmer&)            = delete;
+    ConnectionWarmer& operator=(const ConnectionWarmer&) = delete;
+
+    // Runs the first round right away on the maintenance thread, later ones every interval.
+    void Start();
+
+    Stats GetStats() const;
+
+private:
+    void schedule(std::chrono::milliseconds delay);
+    void round();
+    void warm(bool first);
+    void upkeep();
+
+    const std::string   _name;
+    const WarmupOptions _options;
+
+    std::atomic<uint64_t> _rounds      = 0;
+    std::atomic<size_t>   _warm        = 0;
+    std::atomic<uint64_t> _reopened    = 0;
+    std::atomic<bool>     _multiplexed = false;
+};
+}
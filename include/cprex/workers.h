@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cprex
+{
+// Fixed number of threads serving a FIFO of jobs.
+class WorkerPool final
+{
+public:
+    using Job = std::function<void()>;
+
+    explicit WorkerPool(size_t threads);
+    // Jobs already queued are still run before the threads are joined.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&)            = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Jobs shall handle their failures, whatever they throw is dropped.
+    void Submit(Job job);
+
+    size_t Threads() const
+    {
+        return _threads.size();
+    }
+
+    // Number of jobs waiting for a free thread.
+    size_t Queued() const;
+
+private:
+    void run();
+
+    mutable std::mutex       _mtx;
+    std::condition_variable  _cv;
+    std::deque<Job>          _jobs;
+    bool                     _stop = false;
+    std::vector<std::thread> _threads;
+};
+}
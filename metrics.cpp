@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <sstream>
+
+#include "include/cprex/metrics.h"
+
+namespace cprex
+{
+size_t Histogram::BucketOf(uint64_t value)
+{
+    constexpr uint64_t SubBuckets = uint64_t(1) << SubBits;
+    if (value < SubBuckets)
+        return static_cast<size_t>(value);
+
+    const unsigned msb = std::bit_width(value) - 1;
+    if (msb >= MaxBits)
+        return Buckets - 1;
+
+    // The SubBits bits below the most significant one pick the bucket within its power of two range.
+    const unsigned shift = msb - SubBits;
+    return ((msb - SubBits + 1) << SubBits) + static_cast<size_t>((value >> shift) - SubBuckets);
+}
+
+uint64_t Histogram::LowerBound(size_t bucket)
+{
+    constexpr uint64_t SubBuckets = uint64_t(1) << SubBits;
+    if (bucket < SubBuckets)
+        return bucket;
+
+    const size_t   range = bucket >> SubBits;
+    const uint64_t sub   = bucket & (SubBuckets - 1);
+    return (SubBuckets + sub) << (range - 1);
+}
+
+void Histogram::AddTo(std::vector<uint64_t>& counts, uint64_t& sum) const
+{
+    for (size_t i = 0; i < Buckets; ++i)
+        counts[i] += _counts[i].load(std::memory_order_relaxed);
+    sum += _sum.load(std::memory_order_relaxed);
+}
+
+uint64_t HistogramSnapshot::Percentile(double percentile) const
+{
+    if (!count)
+        return 0;
+
+    const auto rank       = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 1.0) * count));
+    uint64_t   cumulative = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        cumulative += counts[i];
+        if (cumulative >= std::max<uint64_t>(rank, 1))
+            return Histogram::LowerBound(i + 1) - 1;
+    }
+    return Histogram::LowerBound(Histogram::Buckets) - 1;
+}
+
+uint64_t HistogramSnapshot::CountUpTo(uint64_t limit) const
+{
+    uint64_t result = 0;
+    for (size_t i = 0; i < counts.size() && Histogram::LowerBound(i + 1) - 1 <= limit; ++i)
+        result += counts[i];
+    return result;
+}
+
+Metrics::Shard& Metrics::shard()
+{
+    static std::atomic<size_t> next  = 0;
+    thread_local const size_t  index = next.fetch_add(1, std::memory_order_relaxed) % Shards;
+    return _shards[index];
+}
+
+void Metrics::RecordAttempt(const AttemptInfo& attempt, bool first)
+{
+    auto& shard = this->shard();
+    shard.attempts.fetch_add(1, std::memory_order_relaxed);
+    if (first)
+        shard.requests.fetch_add(1, std::memory_order_relaxed);
+
+    shard.total.Record(attempt.total.count());
+    if (attempt.ttfb.count() > 0)
+        shard.ttfb.Record(attempt.ttfb.count());
+
+    if (attempt.reused)
+    {
+        shard.reusedConnections.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    shard.newConnections.fetch_add(1, std::memory_order_relaxed);
+    shard.dns.Record(attempt.dns.count());
+    // =0 if it failed before.
+    if (attempt.connect.count() > 0)
+        shard.connect.Record(attempt.connect.count());
+    // =0 for plain HTTP.
+    if (attempt.tls.count() > 0)
+        shard.tls.Record(attempt.tls.count());
+}
+
+void Metrics::RecordRetry(long statusCode, bool retryAfter)
+{
+    auto& shard = this->shard();
+    if (statusCode < 0 || statusCode >= static_cast<long>(StatusCodes))
+        statusCode = 0;
+    shard.retriesByStatus[statusCode].fetch_add(1, std::memory_order_relaxed);
+    if (retryAfter)
+        shard.retryAfterHonored.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::RecordRejectedRetry(RetryRejection reason)
+{
+    shard().rejectedRetries[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::RecordDirectFallback()
+{
+    shard().directFallbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricsSnapshot Metrics::Snapshot() const
+{
+    MetricsSnapshot snapshot;
+    for (const auto& shard : _shards)
+    {
+        snapshot.requests += shard.requests.load(std::memory_order_relaxed);
+        snapshot.attempts += shard.attempts.load(std::memory_order_relaxed);
+        snapshot.retryAfterHonored += shard.retryAfterHonored.load(std::memory_order_relaxed);
+        snapshot.directFallbacks += shard.directFallbacks.load(std::memory_order_relaxed);
+        snapshot.newConnections += shard.newConnections.load(std::memory_order_relaxed);
+        snapshot.reusedConnections += shard.reusedConnections.load(std::memory_order_relaxed);
+
+        for (size_t status = 0; status < StatusCodes; ++status)
+        {
+            const uint64_t retries = shard.retriesByStatus[status].load(std::memory_order_relaxed);
+            if (!retries)
+                continue;
+            snapshot.retriesByStatus[static_cast<long>(status)] += retries;
+            snapshot.retries += retries;
+        }
+        for (size_t reason = 0; reason < snapshot.rejectedRetries.size(); ++reason)
+            snapshot.rejectedRetries[reason] += shard.rejectedRetries[reason].load(std::memory_order_relaxed);
+
+        shard.total.AddTo(snapshot.total.counts, snapshot.total.sum);
+        shard.dns.AddTo(snapshot.dns.counts, snapshot.dns.sum);
+        shard.connect.AddTo(snapshot.connect.counts, snapshot.connect.sum);
+        shard.tls.AddTo(snapshot.tls.counts, snapshot.tls.sum);
+        shard.ttfb.AddTo(snapshot.ttfb.counts, snapshot.ttfb.sum);
+    }
+
+    for (auto* histogram : {&snapshot.total, &snapshot.dns, &snapshot.connect, &snapshot.tls, &snapshot.ttfb})
+    {
+        for (uint64_t count : histogram->counts)
+            histogram->count += count;
+    }
+    return snapshot;
+}
+
+static std::string Label(const std::string& value)
+{
+    std::string escaped;
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+            escaped += '\\';
+        if (c == '\n')
+        {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string Metrics::Prometheus(const std::map<std::string, MetricsSnapshot>& snapshots)
+{
+    std::ostringstream out;
+
+    auto counter = [&](const char* name, const char* help, uint64_t MetricsSnapshot::*value) {
+        out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << " counter\n";
+        for (const auto& [session, snapshot] : snapshots)
+            out << name << "{session=\"" << Label(session) << "\"} " << snapshot.*value << '\n';
+    };
+
+    counter("cprex_requests_total", "Requests performed, not counting retries.", &MetricsSnapshot::requests);
+    counter("cprex_attempts_total", "Request attempts including retries.", &MetricsSnapshot::attempts);
+    counter("cprex_retry_after_total", "Retries waiting as told by a Retry-After header.",
+        &MetricsSnapshot::retryAfterHonored);
+    counter("cprex_direct_fallbacks_total", "Retries going direct instead of via the proxy.",
+        &MetricsSnapshot::directFallbacks);
+
+    out << "# HELP cprex_retries_total Retries by the status code of the failed attempt, 0 without response.\n"
+        << "# TYPE cprex_retries_total counter\n";
+    for (const auto& [session, snapshot] : snapshots)
+    {
+        for (const auto& [status, retries] : snapshot.retriesByStatus)
+            out << "cprex_retries_total{session=\"" << Label(session) << "\",code=\"" << status << "\"} " << retries
+                << '\n';
+    }
+
+    static constexpr const char* Rejections[] = {"circuit_open", "budget_exhausted"};
+    static_assert(std::size(Rejections) == static_cast<size_t>(RetryRejection::Count));
+    out << "# HELP cprex_retries_rejected_total Retries the RetryPolicy allowed but which weren't made, by reason.\n"
+        << "# TYPE cprex_retries_rejected_total counter\n";
+    for (const auto& [session, snapshot] : snapshots)
+    {
+        for (size_t reason = 0; reason < snapshot.rejectedRetries.size(); ++reason)
+            out << "cprex_retries_rejected_total{session=\"" << Label(session) << "\",reason=\"" << Rejections[reason]
+                << "\"} " << snapshot.rejectedRetries[reason] << '\n';
+    }
+
+    out << "# HELP cprex_connections_total Attempts by whether they reused a cached connection.\n"
+        << "# TYPE cprex_connections_total counter\n";
+    for (const auto& [session, snapshot] : snapshots)
+    {
+        out << "cprex_connections_total{session=\"" << Label(session) << "\",reused=\"false\"} "
+            << snapshot.newConnections << '\n'
+            << "cprex_connections_total{session=\"" << Label(session) << "\",reused=\"true\"} "
+            << snapshot.reusedConnections << '\n';
+    }
+
+    // The HDR buckets are mapped onto these bounds, each counting only buckets entirely below it.
+    static constexpr double Bounds[] = {
+        0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+
+    auto histogram = [&](const char* name, const char* help, HistogramSnapshot MetricsSnapshot::*value) {
+        out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << " histogram\n";
+        for (const auto& [session, snapshot] : snapshots)
+        {
+            const auto& h     = snapshot.*value;
+            const auto  label = Label(session);
+            for (double bound : Bounds)
+            {
+                out << name << "_bucket{session=\"" << label << "\",le=\"" << bound << "\"} "
+                    << h.CountUpTo(static_cast<uint64_t>(bound * 1e6)) << '\n';
+            }
+            out << name << "_bucket{session=\"" << label << "\",le=\"+Inf\"} " << h.count << '\n'
+                << name << "_sum{session=\"" << label << "\"} " << h.sum / 1e6 << '\n'
+                << name << "_count{session=\"" << label << "\"} " << h.count << '\n';
+        }
+    };
+
+    histogram("cprex_attempt_duration_seconds", "Duration of request attempts.", &MetricsSnapshot::total);
+    histogram("cprex_dns_duration_seconds", "Name resolution of attempts on new connections.", &MetricsSnapshot::dns);
+    histogram("cprex_connect_duration_seconds", "TCP connect of attempts on new connections.",
+        &MetricsSnapshot::connect);
+    histogram("cprex_tls_duration_seconds", "TLS handshake of attempts on new connections.", &MetricsSnapshot::tls);
+    histogram("cprex_ttfb_seconds", "Time until the first response byte.", &MetricsSnapshot::ttfb);
+
+    return out.str();
+}
+}
@@ -0,0 +1,186 @@
+#include "include/cprex/multi.h"
+using namespace std::chrono_literals;
+
+namespace cprex
+{
+MultiSession::MultiSession(std::string name, bool trace)
+    : _name(std::move(name))
+    , _trace(trace)
+{
+    _multi        = curl_multi_init();
+    // Transfers to the same host share an HTTP/2 or HTTP/3 connection, libcurl's default made explicit.
+    curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    _inbox        = std::make_shared<Inbox>();
+    _inbox->multi = _multi;
+    _loop         = std::thread(&MultiSession::run, this);
+}
+
+MultiSession::~MultiSession()
+{
+    _stop = true;
+    curl_multi_wakeup(_multi);
+    _loop.join();
+
+    {
+        // Retries becoming due from now on are dropped.
+        std::lock_guard<std::mutex> lock(_inbox->mtx);
+        _inbox->closed = true;
+        _inbox->multi  = nullptr;
+    }
+    curl_multi_cleanup(_multi);
+}
+
+std::unique_ptr<MultiSession::Transfer> MultiSession::newTransfer(SessionLease lease)
+{
+    auto transfer   = std::make_unique<Transfer>();
+    transfer->lease = std::move(lease);
+    if (_trace)
+        transfer->lease->EnableTrace();
+
+    CURL* curl = transfer->lease->_session.GetCurlHolder()->handle;
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer.get());
+
+    return transfer;
+}
+
+void MultiSession::enqueue(std::unique_ptr<Transfer> transfer)
+{
+    ++_inFlight;
+
+    std::lock_guard<std::mutex> lock(_inbox->mtx);
+    _inbox->submitted.push_back(std::move(transfer));
+    curl_multi_wakeup(_multi);
+}
+
+void MultiSession::enqueue(SessionLease lease, Done done)
+{
+    auto transfer  = newTransfer(std::move(lease));
+    transfer->done = std::move(done);
+    enqueue(std::move(transfer));
+}
+
+void MultiSession::park(Transfer* transfer, std::chrono::milliseconds wait)
+{
+    // The transfer and its easy handle stay owned by the event loop, only the wakeup is delegated.
+    Factory::RetryScheduler().Schedule(wait, [inbox = _inbox, transfer] {
+        std::lock_guard<std::mutex> lock(inbox->mtx);
+        if (inbox->closed)
+            return;
+        inbox->due.push_back(transfer);
+        curl_multi_wakeup(inbox->multi);
+    });
+}
+
+void MultiSession::run()
+{
+    std::vector<std::unique_ptr<Transfer>> submitted;
+    std::vector<Transfer*>                 due;
+
+    while (!_stop)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_inbox->mtx);
+            submitted.swap(_inbox->submitted);
+            due.swap(_inbox->due);
+        }
+        for (auto& transfer : submitted)
+        {
+            auto raw = transfer.get();
+            _transfers.emplace(raw, std::move(transfer));
+            start(raw);
+        }
+        submitted.clear();
+
+        for (auto transfer : due)
+            start(transfer);
+        due.clear();
+
+        int running = 0;
+        curl_multi_perform(_multi, &running);
+
+        int      pending = 0;
+        CURLMsg* msg;
+        while ((msg = curl_multi_info_read(_multi, &pending)))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+            const CURLcode curl_error = msg->data.result;
+
+            curl_multi_remove_handle(_multi, msg->easy_handle);
+            complete(transfer, curl_error);
+        }
+
+        // Sleep until there is network activity, a new submission, or a parked retry became due.
+        curl_multi_poll(_multi, nullptr, 0, 1000, nullptr);
+    }
+
+    abortAll();
+}
+
+void MultiSession::start(Transfer* transfer)
+{
+    if (!transfer->lease->admit(transfer->retryState))
+    {
+        complete(transfer, CURLE_ABORTED_BY_CALLBACK);
+        return;
+    }
+
+    transfer->lease->prepare();
+    curl_multi_add_handle(_multi, transfer->lease->_session.GetCurlHolder()->handle);
+}
+
+void MultiSession::complete(Transfer* transfer, CURLcode curl_error)
+{
+    auto& session = *transfer->lease;
+
+    auto waitMilliSeconds = session.nextAttempt(curl_error, transfer->retryState);
+    if (waitMilliSeconds)
+    {
+        park(transfer, *waitMilliSeconds);
+        return;
+    }
+
+    session.finishAttempts(transfer->retryState);
+    auto response = session.complete(curl_error, transfer->retryState);
+
+    auto owned = std::move(_transfers[transfer]);
+    _transfers.erase(transfer);
+    --_inFlight;
+
+    owned->done(std::move(response));
+}
+
+void MultiSession::abortAll()
+{
+    // Transfers taken on so far are running or parked for a retry, both admitted by the circuit breaker.
+    for (auto& [raw, transfer] : _transfers)
+        transfer->lease->abandon();
+
+    {
+        std::lock_guard<std::mutex> lock(_inbox->mtx);
+        for (auto& transfer : _inbox->submitted)
+        {
+            auto raw = transfer.get();
+            _transfers.emplace(raw, std::move(transfer));
+        }
+        _inbox->submitted.clear();
+        _inbox->due.clear();
+    }
+
+    for (auto& [raw, transfer] : _transfers)
+    {
+        auto& session = *transfer->lease;
+        curl_multi_remove_handle(_multi, session._session.GetCurlHolder()->handle);
+
+        Response response;
+        response.url   = session._requestUrl;
+        response.error = cpr::Error(CURLE_ABORTED_BY_CALLBACK, "MultiSession destroyed");
+        transfer->done(std::move(response));
+    }
+    _transfers.clear();
+    _inFlight = 0;
+}
+}
@@ -0,0 +1,106 @@
+#include "include/cprex/cprex.h"
+
+namespace cprex
+{
+SessionLease::SessionLease(std::shared_ptr<SessionPool> pool, std::unique_ptr<Session> session)
+    : _pool(std::move(pool))
+    , _session(std::move(session))
+{
+}
+
+SessionLease::SessionLease(SessionLease&& other) noexcept = default;
+
+SessionLease& SessionLease::operator=(SessionLease&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (_session)
+            _pool->release(std::move(_session));
+
+        _pool    = std::move(other._pool);
+        _session = std::move(other._session);
+    }
+    return *this;
+}
+
+SessionLease::~SessionLease()
+{
+    if (_session)
+        _pool->release(std::move(_session));
+}
+
+SessionPool::SessionPool(Create create, Reset reset, PoolOptions options)
+    : _create(std::move(create))
+    , _reset(std::move(reset))
+    , _options(options)
+{
+    if (_options.maxSize < _options.minSize)
+        _options.maxSize = _options.minSize;
+}
+
+SessionPool::~SessionPool() = default;
+
+SessionLease SessionPool::Acquire()
+{
+    std::call_once(_filled, [this] { Fill(); });
+
+    std::unique_ptr<Session>              session;
+    std::vector<std::unique_ptr<Session>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        evict(Clock::now(), evicted);
+        if (!_idle.empty())
+        {
+            session = std::move(_idle.back().session);
+            _idle.pop_back();
+        }
+    }
+
+    if (!session)
+        session = _create();
+
+    return SessionLease(shared_from_this(), std::move(session));
+}
+
+void SessionPool::Fill()
+{
+    while (Idle() < _options.minSize)
+        release(_create());
+}
+
+size_t SessionPool::Idle() const
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _idle.size();
+}
+
+void SessionPool::release(std::unique_ptr<Session> session)
+{
+    if (!_reset(*session))
+        return;
+
+    std::vector<std::unique_ptr<Session>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        const auto                  now = Clock::now();
+        evict(now, evicted);
+        if (_idle.size() >= _options.maxSize)
+            evicted.push_back(std::move(session));
+        else
+            _idle.push_back({now, std::move(session)});
+    }
+}
+
+void SessionPool::evict(Clock::time_point now, std::vector<std::unique_ptr<Session>>& evicted)
+{
+    // The front holds the sessions idle for the longest time.
+    size_t expired = 0;
+    while (expired < _idle.size() && _idle.size() - expired > _options.minSize &&
+           now - _idle[expired].since > _options.idleTimeout)
+    {
+        evicted.push_back(std::move(_idle[expired].session));
+        ++expired;
+    }
+    _idle.erase(_idle.begin(), _idle.begin() + expired);
+}
+}
@@ -0,0 +1,48 @@
+#include "include/cprex/preset.h"
+
+namespace cprex
+{
+// The same format cpr uses, "name;" sends a header without a value.
+static std::string HeaderLine(const std::string& name, const std::string& value)
+{
+    return value.empty() ? name + ';' : name + ": " + value;
+}
+
+RequestPreset::RequestPreset(const cpr::Header& header, const cpr::Parameters& parameters)
+    : _header(header)
+    , _headers(Merge({}))
+{
+    if (!parameters.empty())
+        _query = parameters.GetContent(cpr::CurlHolder());
+}
+
+HeaderList RequestPreset::Merge(const cpr::Header& overlay) const
+{
+    HeaderList list;
+    for (const auto& [name, value] : overlay)
+        list = append(std::move(list), HeaderLine(name, value));
+
+    for (const auto& [name, value] : _header)
+    {
+        if (!overlay.contains(name))
+            list = append(std::move(list), HeaderLine(name, value));
+    }
+
+    // As cpr does, keeps libcurl from waiting for "100 Continue" before uploading larger bodies.
+    if (!overlay.contains("Expect") && !_header.contains("Expect"))
+        list = append(std::move(list), "Expect:");
+
+    return list;
+}
+
+HeaderList RequestPreset::append(HeaderList list, const std::string& line)
+{
+    curl_slist* appended = curl_slist_append(list.get(), line.c_str());
+    if (!appended)
+        throw new std::exception("Can't build header list");
+
+    // Now owned by appended.
+    list.release();
+    return HeaderList(appended);
+}
+}
@@ -0,0 +1,34 @@
+#include <random>
+
+#include "include/cprex/random.h"
+
+namespace cprex
+{
+namespace Random
+{
+uint64_t Mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t Next()
+{
+    // splitmix64: https://prng.di.unimi.it/splitmix64.c
+    thread_local uint64_t state = (uint64_t(std::random_device {}()) << 32) ^ std::random_device {}();
+
+    state += 0x9e3779b97f4a7c15ull;
+    return Mix(state);
+}
+
+double NextDouble()
+{
+    // The upper 53 bits fill the mantissa of a double.
+    return (Next() >> 11) * 0x1.0p-53;
+}
+}
+}
@@ -0,0 +1,337 @@
+#include <algorithm>
+
+#include "include/cprex/cprex.h"
+#include "include/cprex/ranged.h"
+
+namespace cprex
+{
+struct RangedDownload::Range
+{
+    RangedDownload* owner;
+    uint64_t        begin;
+    // Exclusive, std::nullopt if the size is unknown.
+    std::optional<uint64_t> end;
+    // Where the next byte goes.
+    uint64_t next;
+
+    SessionLease                     lease;
+    RetryState                       retryState;
+    std::optional<Clock::time_point> due;
+    // Whether the response of the current attempt is written or dropped, decided on its first byte.
+    std::optional<bool> accepted;
+    bool                ranged = false;
+    bool                done   = false;
+    // Admitted by the circuit breaker, i.e. an attempt is running or due.
+    bool admitted = false;
+};
+
+RangedDownload::RangedDownload(Session& session, const cpr::fs::path& path, const RangedDownloadOptions& options,
+    std::function<void(Session&)> setOptions)
+    : _session(session)
+    , _options(options)
+    , _setOptions(std::move(setOptions))
+    , _file(path)
+    , _reported(_started)
+{
+}
+
+RangedDownload::~RangedDownload() = default;
+
+Response RangedDownload::Run()
+{
+    auto head = probe();
+    if (head.error)
+        return head;
+
+    split();
+    if (_total)
+        _file.Preallocate(*_total);
+
+    _multi = curl_multi_init();
+    // Each range gets a connection of its own, even if the server speaks HTTP/2.
+    curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+
+    Range*   failed      = nullptr;
+    CURLcode failedError = CURLE_OK;
+    for (auto& range : _ranges)
+    {
+        if (!start(*range))
+        {
+            failed      = range.get();
+            failedError = CURLE_ABORTED_BY_CALLBACK;
+            break;
+        }
+    }
+
+    size_t remaining = _ranges.size();
+    while (!failed && remaining)
+    {
+        int running = 0;
+        curl_multi_perform(_multi, &running);
+
+        int      pending = 0;
+        CURLMsg* msg;
+        while (!failed && (msg = curl_multi_info_read(_multi, &pending)))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            Range* range = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &range);
+            CURLcode curl_error = msg->data.result;
+            curl_multi_remove_handle(_multi, msg->easy_handle);
+
+            // All bytes of the range arrived, a failure afterwards doesn't matter.
+            if (range->end && range->next == *range->end)
+                curl_error = CURLE_OK;
+
+            auto& session          = *range->lease;
+            auto  waitMilliSeconds = session.nextAttempt(curl_error, range->retryState, _resumable);
+            if (waitMilliSeconds)
+            {
+                range->due = Clock::now() + *waitMilliSeconds;
+                continue;
+            }
+            session.finishAttempts(range->retryState);
+            range->admitted = false;
+
+            long status_code = 0;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &status_code);
+            if (curl_error == CURLE_OK && StatusCode::Succeeded(status_code))
+            {
+                range->done = true;
+                --remaining;
+            }
+            else
+            {
+                failed      = range;
+                failedError = curl_error;
+            }
+        }
+        if (failed || !remaining)
+            break;
+
+        // Ranges waiting for their next attempt don't hold a connection.
+        const auto now     = Clock::now();
+        auto       timeout = _options.progressInterval;
+        for (auto& range : _ranges)
+        {
+            if (!range->due)
+                continue;
+
+            if (*range->due <= now)
+            {
+                range->due.reset();
+                if (!start(*range))
+                {
+                    failed      = range.get();
+                    failedError = CURLE_ABORTED_BY_CALLBACK;
+                    break;
+                }
+            }
+            else
+            {
+                timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(*range->due - now));
+            }
+        }
+
+        report(false);
+        curl_multi_poll(_multi, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+    }
+
+    // Cancels the ranges still running, if any.
+    for (auto& range : _ranges)
+    {
+        curl_multi_remove_handle(_multi, range->lease->_session.GetCurlHolder()->handle);
+        if (range->admitted)
+            range->lease->abandon();
+    }
+    curl_multi_cleanup(_multi);
+    _multi = nullptr;
+
+    if (failed)
+        return complete(*failed, failedError);
+
+    if (!_total)
+        _file.Resize(_received);
+    report(true);
+
+    // Like a single GET of the whole file.
+    auto response             = complete(*_ranges.front(), CURLE_OK);
+    response.status_code      = 200;
+    response.downloaded_bytes = static_cast<long>(_received);
+    return response;
+}
+
+Response RangedDownload::probe()
+{
+    _setOptions(_session);
+    auto head      = _session.makeRequestEx(Session::Verb<&Session::PrepareHead> {});
+    _probeAttempts = head.attempts;
+
+    // Some servers don't support HEAD, then the file is fetched in one piece.
+    if (!StatusCode::Succeeded(head.status_code))
+        return head;
+
+    auto length = head.header.find("Content-Length");
+    if (length != std::end(head.header))
+    {
+        try
+        {
+            _total = std::stoull(length->second);
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    auto ranges = head.header.find("Accept-Ranges");
+    _resumable  = ranges != std::end(head.header) && ranges->second.find("bytes") != std::string::npos;
+
+    return head;
+}
+
+void RangedDownload::split()
+{
+    uint64_t count = 1;
+    if (_total && _resumable)
+    {
+        const uint64_t connections = std::max<uint64_t>(_options.connections, 1);
+        count = std::clamp<uint64_t>(*_total / std::max<uint64_t>(_options.minRangeSize, 1), 1, connections);
+    }
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        auto range   = std::make_unique<Range>();
+        range->owner = this;
+        if (_total)
+        {
+            range->begin = i * (*_total / count);
+            range->end   = i + 1 == count ? *_total : (i + 1) * (*_total / count);
+        }
+        else
+        {
+            range->begin = 0;
+        }
+        range->next = range->begin;
+
+        range->lease = Factory::AcquireSession(_session._name);
+        _setOptions(*range->lease);
+        range->lease->_prepper = [this, raw = range.get()](Session* session) {
+            session->PrepareGet();
+            attach(*raw);
+        };
+
+        _ranges.push_back(std::move(range));
+    }
+}
+
+bool RangedDownload::start(Range& range)
+{
+    auto& session = *range.lease;
+    if (!session.admit(range.retryState))
+        return false;
+
+    range.admitted = true;
+    session.prepare();
+    curl_multi_add_handle(_multi, session._session.GetCurlHolder()->handle);
+    return true;
+}
+
+void RangedDownload::attach(Range& range)
+{
+    CURL* curl = range.lease->_session.GetCurlHolder()->handle;
+
+    if (range.next > range.begin && !_resumable)
+    {
+        // Without range support the next attempt starts all over.
+        _received -= range.next - range.begin;
+        range.next = range.begin;
+    }
+
+    range.accepted.reset();
+    range.ranged = range.next > 0 || (range.end && *range.end != *_total);
+    if (range.ranged)
+    {
+        const std::string spec = std::to_string(range.next) + '-' + (range.end ? std::to_string(*range.end - 1) : "");
+        curl_easy_setopt(curl, CURLOPT_RANGE, spec.c_str());
+    }
+    else
+    {
+        curl_easy_setopt(curl, CURLOPT_RANGE, nullptr);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &RangedDownload::write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &range);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, &range);
+}
+
+Response RangedDownload::complete(Range& range, CURLcode curl_error)
+{
+    AttemptLog attempts = std::move(_probeAttempts);
+    for (auto& other : _ranges)
+    {
+        auto& log = other->retryState.attempts;
+        attempts.insert(
+            std::end(attempts), std::make_move_iterator(std::begin(log)), std::make_move_iterator(std::end(log)));
+        log.clear();
+    }
+
+    range.retryState.attempts = std::move(attempts);
+    return range.lease->completeDownload(curl_error, range.retryState);
+}
+
+void RangedDownload::report(bool force)
+{
+    if (!_options.progress)
+        return;
+
+    const auto now = Clock::now();
+    if (!force && now - _reported < _options.progressInterval)
+        return;
+    _reported = now;
+
+    const double seconds = std::chrono::duration<double>(now - _started).count();
+    _options.progress({_total.value_or(0), _received,
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - _started),
+        seconds > 0 ? static_cast<double>(_received) / seconds : 0.0, _ranges.size()});
+}
+
+size_t RangedDownload::write(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    auto&        range = *static_cast<Range*>(userdata);
+    auto&        self  = *range.owner;
+    const size_t total = size * nmemb;
+
+    if (!range.accepted)
+    {
+        long status_code = 0;
+        curl_easy_getinfo(range.lease->_session.GetCurlHolder()->handle, CURLINFO_RESPONSE_CODE, &status_code);
+
+        // A server ignoring the range sends the whole file, which doesn't fit here.
+        if (range.ranged && status_code == 200)
+            return 0;
+        range.accepted = range.ranged ? status_code == 206 : StatusCode::Succeeded(status_code);
+    }
+    // Error pages aren't part of the file.
+    if (!*range.accepted)
+        return total;
+
+    if (range.end && range.next + total > *range.end)
+        return 0;
+
+    try
+    {
+        self._file.WriteAt(range.next, ptr, total);
+    }
+    catch (std::exception* e)
+    {
+        delete e;
+        return 0;
+    }
+
+    range.next += total;
+    self._received += total;
+    return total;
+}
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <climits>
+
+#include "include/cprex/cprex.h"
+#include "include/cprex/resolver.h"
+
+namespace cprex
+{
+HostResolver::HostResolver(const DnsOptions& options)
+    : _options(options)
+{
+    ares_library_init(ARES_LIB_INIT_ALL);
+
+    // Lookups are driven by c-ares' own event thread, without it libcurl keeps resolving on its own.
+    ares_options aresOptions {};
+    aresOptions.evsys = ARES_EVSYS_DEFAULT;
+    if (!ares_threadsafety() || ares_init_options(&_channel, &aresOptions, ARES_OPT_EVENT_THREAD) != ARES_SUCCESS)
+    {
+        _channel = nullptr;
+        return;
+    }
+
+    if (!_options.servers.empty() && ares_set_servers_ports_csv(_channel, _options.servers.c_str()) != ARES_SUCCESS)
+    {
+        ares_destroy(_channel);
+        _channel = nullptr;
+        throw new std::exception("Invalid DNS servers");
+    }
+}
+
+HostResolver::~HostResolver()
+{
+    if (_channel)
+        ares_destroy(_channel);
+    ares_library_cleanup();
+}
+
+void HostResolver::Watch(std::string_view host, uint16_t port)
+{
+    if (!_channel || host.empty() || !port || host.front() == '[')
+        return;
+
+    std::string name(host);
+    in_addr     ipv4;
+    if (ares_inet_pton(AF_INET, name.c_str(), &ipv4) == 1)
+        return;
+
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        for (const auto& watched : _hosts)
+        {
+            if (watched.name == name && watched.port == port)
+                return;
+        }
+        _hosts.push_back({std::move(name), port, {}});
+        index = _hosts.size() - 1;
+    }
+    resolve(index);
+}
+
+std::shared_ptr<curl_slist> HostResolver::Current() const
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _current;
+}
+
+void HostResolver::resolve(size_t host)
+{
+    std::string name, service;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        name    = _hosts[host].name;
+        service = std::to_string(_hosts[host].port);
+    }
+
+    ares_addrinfo_hints hints {};
+    hints.ai_family = AF_UNSPEC;
+    ares_getaddrinfo(
+        _channel, name.c_str(), service.c_str(), &hints, &HostResolver::resolved, new Lookup {weak_from_this(), host});
+}
+
+void HostResolver::resolved(void* arg, int status, int timeouts, ares_addrinfo* result)
+{
+    std::unique_ptr<Lookup> lookup(static_cast<Lookup*>(arg));
+
+    std::vector<std::string> addresses;
+    int                      ttl = INT_MAX;
+    for (auto node = result ? result->nodes : nullptr; node; node = node->ai_next)
+    {
+        char address[64];
+        if (node->ai_family == AF_INET)
+        {
+            ares_inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(node->ai_addr)->sin_addr, address, sizeof(address));
+            addresses.emplace_back(address);
+        }
+        else if (node->ai_family == AF_INET6)
+        {
+            ares_inet_ntop(
+                AF_INET6, &reinterpret_cast<sockaddr_in6*>(node->ai_addr)->sin6_addr, address, sizeof(address));
+            addresses.push_back('[' + std::string(address) + ']');
+        }
+        else
+        {
+            continue;
+        }
+        ttl = std::min(ttl, node->ai_ttl);
+    }
+    if (result)
+        ares_freeaddrinfo(result);
+
+    if (status == ARES_EDESTRUCTION)
+        return;
+
+    // This runs on c-ares' event thread, which must not end up destroying the channel, so the resolver is only
+    // locked on a worker.
+    Factory::Workers().Submit([resolver = lookup->resolver, host = lookup->host, addresses = std::move(addresses),
+                                  ttl]() mutable {
+        auto self = resolver.lock();
+        if (!self)
+            return;
+
+        // Failed lookups keep the previous addresses and are repeated after minTtl.
+        auto delay = self->_options.minTtl;
+        if (!addresses.empty())
+        {
+            const auto seconds = std::clamp(std::chrono::seconds(ttl), self->_options.minTtl, self->_options.maxTtl);
+            delay = std::chrono::duration_cast<std::chrono::seconds>(seconds * self->_options.refreshAt);
+
+            std::lock_guard<std::mutex> lock(self->_mtx);
+            auto&                       watched = self->_hosts[host];
+            if (watched.addresses != addresses)
+            {
+                watched.addresses = std::move(addresses);
+                self->publish();
+            }
+        }
+        self->refresh(host, std::max(delay, std::chrono::seconds(1)));
+    });
+}
+
+void HostResolver::refresh(size_t host, std::chrono::seconds delay)
+{
+    // Starting a lookup doesn't block, it's fine to do so on the scheduler thread.
+    Factory::RetryScheduler().Schedule(delay, [resolver = weak_from_this(), host] {
+        if (auto self = resolver.lock())
+            self->resolve(host);
+    });
+}
+
+void HostResolver::publish()
+{
+    curl_slist* list = nullptr;
+    for (const auto& host : _hosts)
+    {
+        if (host.addresses.empty())
+            continue;
+
+        std::string entry = host.name + ':' + std::to_string(host.port) + ':';
+        for (size_t i = 0; i < host.addresses.size(); ++i)
+        {
+            if (i)
+                entry += ',';
+            entry += host.addresses[i];
+        }
+        list = curl_slist_append(list, entry.c_str());
+    }
+
+    _current = std::shared_ptr<curl_slist>(list, curl_slist_free_all);
+    _generation.fetch_add(1, std::memory_order_release);
+}
+}
@@ -0,0 +1,104 @@
+#include <sstream>
+
+#include "include/cprex/response.h"
+
+namespace cprex
+{
+AttemptInfo AttemptInfo::Read(CURL* curl, CURLcode error)
+{
+    // All in microseconds since the start of the attempt.
+    curl_off_t total = 0, dns = 0, connect = 0, tls = 0, ttfb = 0;
+    long       connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+    AttemptInfo attempt;
+    attempt.total = std::chrono::microseconds(total);
+    attempt.ttfb  = std::chrono::microseconds(ttfb);
+    attempt.error = error;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &attempt.statusCode);
+    // No new connection is also what libcurl reports if resolving or connecting failed, then nothing was reused.
+    attempt.reused = connects == 0 && (error == CURLE_OK || attempt.statusCode != 0);
+    if (attempt.reused)
+        return attempt;
+
+    attempt.dns = std::chrono::microseconds(dns);
+    if (connect >= dns)
+        attempt.connect = std::chrono::microseconds(connect - dns);
+    // =0 for plain HTTP.
+    if (tls > connect)
+        attempt.tls = std::chrono::microseconds(tls - connect);
+    return attempt;
+}
+
+SlowRequestLog::SlowRequestLog(const SlowRequestOptions& options)
+    : _options(options)
+{
+    _requests.reserve(_options.capacity);
+}
+
+void SlowRequestLog::Record(const Response& response, std::chrono::microseconds elapsed)
+{
+    if (elapsed <= _options.threshold || !_options.capacity)
+        return;
+
+    SlowRequest request {std::chrono::system_clock::now(), elapsed, response.url.str(), response.status_code,
+        response.error, response.header, response.attempts};
+
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_requests.size() < _options.capacity)
+    {
+        _requests.push_back(std::move(request));
+        return;
+    }
+    _requests[_next] = std::move(request);
+    _next            = (_next + 1) % _options.capacity;
+}
+
+std::vector<SlowRequest> SlowRequestLog::Snapshot() const
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    std::vector<SlowRequest>    requests(_requests.begin() + _next, _requests.end());
+    requests.insert(requests.end(), _requests.begin(), _requests.begin() + _next);
+    return requests;
+}
+
+std::string SlowRequestLog::Format(const std::vector<SlowRequest>& requests)
+{
+    auto ms = [](std::chrono::microseconds us) { return us.count() / 1000.0; };
+
+    std::ostringstream out;
+    for (const auto& request : requests)
+    {
+        const auto finished =
+            std::chrono::duration_cast<std::chrono::milliseconds>(request.finished.time_since_epoch()).count();
+
+        out << finished << " " << request.url << " " << request.statusCode << " " << ms(request.elapsed)
+            << "ms in " << request.attempts.size() << " attempts";
+        if (request.error)
+            out << ", error " << static_cast<int>(request.error.code) << " " << request.error.message;
+        out << '\n';
+
+        for (size_t i = 0; i < request.attempts.size(); ++i)
+        {
+            const auto& attempt = request.attempts[i];
+            out << "  #" << i + 1 << " " << (attempt.proxy.empty() ? "direct" : attempt.proxy) << " "
+                << attempt.statusCode << " curl " << static_cast<int>(attempt.error) << ", total " << ms(attempt.total)
+                << "ms ttfb " << ms(attempt.ttfb) << "ms";
+            if (attempt.reused)
+                out << " reused";
+            else
+                out << " dns " << ms(attempt.dns) << "ms connect " << ms(attempt.connect) << "ms tls "
+                    << ms(attempt.tls) << "ms";
+            if (attempt.wait.count())
+                out << ", " << (attempt.retryAfter ? "Retry-After " : "backoff ") << attempt.wait.count() << "ms";
+            out << '\n';
+        }
+    }
+    return out.str();
+}
+}
@@ -0,0 +1,66 @@
+#include "include/cprex/scheduler.h"
+
+namespace cprex
+{
+Scheduler::Scheduler()
+{
+    _thread = std::thread(&Scheduler::run, this);
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+}
+
+void Scheduler::Schedule(std::chrono::milliseconds delay, Task task)
+{
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _timers.push({Clock::now() + delay, _seq++, std::move(task)});
+        earliest = _timers.top().seq == _seq - 1;
+    }
+    // Only a new head of the heap changes how long the scheduler thread has to sleep.
+    if (earliest)
+        _cv.notify_one();
+}
+
+size_t Scheduler::Pending() const
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _timers.size();
+}
+
+void Scheduler::run()
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (!_stop)
+    {
+        if (_timers.empty())
+        {
+            _cv.wait(lock);
+            continue;
+        }
+
+        const auto due = _timers.top().due;
+        if (Clock::now() < due)
+        {
+            _cv.wait_until(lock, due);
+            continue;
+        }
+
+        // priority_queue::top() is const, the task is moved out via const_cast as pop() follows immediately.
+        auto task = std::move(const_cast<Timer&>(_timers.top()).task);
+        _timers.pop();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+}
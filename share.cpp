@@ -0,0 +1,80 @@
+#include "include/cprex/share.h"
+
+namespace cprex
+{
+Share::Share()
+{
+    // https://everything.curl.dev/helpers/sharing.html
+    _share = curl_share_init();
+    curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, &Share::lock);
+    curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, &Share::unlock);
+    curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // Not CURL_LOCK_DATA_CONNECT: libcurl doesn't support sharing the connection cache between threads performing
+    // transfers at the same time, no matter the locks. Connections stay with the easy or multi handle which opened them.
+}
+
+Share::~Share()
+{
+    curl_share_cleanup(_share);
+}
+
+Share::LockStats Share::Stats(curl_lock_data data) const
+{
+    const auto& l = _locks[data];
+    return {l.acquired.load(std::memory_order_relaxed), l.contended.load(std::memory_order_relaxed)};
+}
+
+void Share::lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr)
+{
+    (void)handle; /* prevent compiler warning */
+    auto  self = static_cast<Share*>(userptr);
+    auto& l    = self->_locks[data];
+
+    const bool shared = access == CURL_LOCK_ACCESS_SHARED;
+
+    if (self->_countContention.load(std::memory_order_relaxed))
+    {
+        l.acquired.fetch_add(1, std::memory_order_relaxed);
+        if (shared ? l.mtx.try_lock_shared() : l.mtx.try_lock())
+        {
+            if (!shared)
+                l.owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+            return;
+        }
+        l.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (shared)
+    {
+        l.mtx.lock_shared();
+    }
+    else
+    {
+        l.mtx.lock();
+        l.owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    }
+}
+
+void Share::unlock(CURL* handle, curl_lock_data data, void* userptr)
+{
+    (void)handle; /* prevent compiler warning */
+    auto  self = static_cast<Share*>(userptr);
+    auto& l    = self->_locks[data];
+
+    // While a thread holds the lock exclusively nobody else can hold it, so the owner is only ever compared by the
+    // thread which set it.
+    if (l.owner.load(std::memory_order_relaxed) == std::this_thread::get_id())
+    {
+        l.owner.store(std::thread::id(), std::memory_order_relaxed);
+        l.mtx.unlock();
+    }
+    else
+    {
+        l.mtx.unlock_shared();
+    }
+}
+}
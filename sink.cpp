@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstring>
+
+#include "include/cprex/cprex.h"
+#include "include/cprex/sink.h"
+
+namespace cprex
+{
+static constexpr size_t MaxPooledBuffers = 8;
+
+std::mutex                    FileSink::_poolMtx;
+std::vector<FileSink::Buffer> FileSink::_pool;
+size_t                        FileSink::_poolBufferSize = 0;
+
+FileSink::FileSink(const cpr::fs::path& path, const FileSinkOptions& options) : _options(options), _file(path)
+{
+}
+
+FileSink::~FileSink()
+{
+    try
+    {
+        Close();
+    }
+    catch (std::exception* e)
+    {
+        delete e;
+    }
+}
+
+void FileSink::Close()
+{
+    if (_closed)
+        return;
+    _closed = true;
+
+    flush();
+    if (_buffer)
+        releaseBuffer(std::move(_buffer), _options.bufferSize);
+
+    if (_mapping && _options.sync != FileSinkOptions::Sync::None)
+        _file.FlushMapping(_mapping, _written - _mapOffset);
+    unmap();
+
+    // Drops what was preallocated or mapped beyond the end.
+    _file.Resize(_written);
+    if (_options.sync != FileSinkOptions::Sync::None)
+        _file.Sync();
+}
+
+void FileSink::attach(CURL* curl)
+{
+    // A new attempt starts over, whatever is in the file already gets overwritten or trimmed on close.
+    unmap();
+    _curl     = curl;
+    _accepted = std::nullopt;
+    _written  = 0;
+    _unsynced = 0;
+    _used     = 0;
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &FileSink::writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+}
+
+size_t FileSink::writeCallback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    auto&        sink  = *static_cast<FileSink*>(userdata);
+    const size_t total = size * nmemb;
+
+    try
+    {
+        if (!sink._accepted)
+        {
+            long status_code = 0;
+            curl_easy_getinfo(sink._curl, CURLINFO_RESPONSE_CODE, &status_code);
+            sink._accepted = StatusCode::Succeeded(status_code);
+
+            curl_off_t length = -1;
+            curl_easy_getinfo(sink._curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+            if (*sink._accepted && length > 0 && static_cast<uint64_t>(length) > sink._allocated)
+            {
+                sink._file.Preallocate(static_cast<uint64_t>(length));
+                sink._allocated = static_cast<uint64_t>(length);
+            }
+        }
+        if (*sink._accepted)
+            sink.write(ptr, total);
+    }
+    catch (std::exception* e)
+    {
+        delete e;
+        return 0;
+    }
+    return total;
+}
+
+void FileSink::write(const char* data, size_t size)
+{
+    if (_options.mode == FileSinkOptions::Mode::Mapped)
+    {
+        while (size)
+        {
+            if (!_mapping || _written == _mapOffset + _mapped)
+                map(_written);
+
+            const size_t n = std::min<uint64_t>(size, _mapOffset + _mapped - _written);
+            std::memcpy(_mapping + (_written - _mapOffset), data, n);
+            data += n;
+            size -= n;
+            _written += n;
+            written(n);
+        }
+        return;
+    }
+
+    while (size)
+    {
+        if (!_buffer)
+            _buffer = acquireBuffer(_options.bufferSize);
+
+        const size_t n = std::min(size, _options.bufferSize - _used);
+        std::memcpy(_buffer.get() + _used, data, n);
+        data += n;
+        size -= n;
+        _used += n;
+        _written += n;
+
+        if (_used == _options.bufferSize)
+            flush();
+    }
+}
+
+void FileSink::flush()
+{
+    if (!_used)
+        return;
+
+    // Batches start at multiples of bufferSize.
+    const size_t n = _used;
+    _file.WriteAt(_written - n, _buffer.get(), n);
+    _used = 0;
+    written(n);
+}
+
+void FileSink::map(uint64_t offset)
+{
+    unmap();
+
+    const size_t alignment = File::MapAlignment();
+    _mapOffset             = offset / alignment * alignment;
+    _mapped                = std::max<size_t>(_options.mapSize / alignment, 1) * alignment;
+
+    const uint64_t end = _mapOffset + _mapped;
+    if (end > _allocated)
+    {
+        _file.Resize(end);
+        _allocated = end;
+    }
+    _mapping = _file.Map(_mapOffset, _mapped);
+}
+
+void FileSink::unmap()
+{
+    if (!_mapping)
+        return;
+
+    _file.Unmap(_mapping, _mapped);
+    _mapping = nullptr;
+}
+
+void FileSink::written(uint64_t bytes)
+{
+    if (_options.sync != FileSinkOptions::Sync::Periodic)
+        return;
+
+    _unsynced += bytes;
+    if (_unsynced < _options.syncInterval)
+        return;
+
+    if (_mapping)
+        _file.FlushMapping(_mapping, _written - _mapOffset);
+    _file.Sync();
+    _unsynced = 0;
+}
+
+FileSink::Buffer FileSink::acquireBuffer(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(_poolMtx);
+        if (size == _poolBufferSize && !_pool.empty())
+        {
+            auto buffer = std::move(_pool.back());
+            _pool.pop_back();
+            return buffer;
+        }
+    }
+    return std::make_unique_for_overwrite<char[]>(size);
+}
+
+void FileSink::releaseBuffer(Buffer buffer, size_t size)
+{
+    std::lock_guard<std::mutex> lock(_poolMtx);
+
+    // Only buffers of the size most recently used are kept.
+    if (size != _poolBufferSize)
+    {
+        _pool.clear();
+        _poolBufferSize = size;
+    }
+    if (_pool.size() < MaxPooledBuffers)
+        _pool.push_back(std::move(buffer));
+}
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstring>
+
+#include "include/cprex/cprex.h"
+#include "include/cprex/stream.h"
+
+namespace cprex
+{
+// libcurl's CURL_MAX_WRITE_SIZE, so a single write callback always fits into a fresh chunk.
+static constexpr size_t MinChunkSize = 16 * 1024;
+
+ChunkPool::ChunkPool(const StreamOptions& options)
+    : _chunkSize(std::max(options.chunkSize, MinChunkSize))
+    , _chunks(std::max<size_t>(options.chunks, 1))
+{
+}
+
+std::unique_ptr<char[]> ChunkPool::Acquire()
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (!_free.empty())
+    {
+        auto buffer = std::move(_free.back());
+        _free.pop_back();
+        return buffer;
+    }
+    if (_allocated == _chunks)
+        return nullptr;
+
+    ++_allocated;
+    return std::make_unique_for_overwrite<char[]>(_chunkSize);
+}
+
+void ChunkPool::Release(std::unique_ptr<char[]> buffer)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    _free.push_back(std::move(buffer));
+}
+
+size_t ChunkPool::Available() const
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _free.size() + _chunks - _allocated;
+}
+
+Chunk::Chunk(std::shared_ptr<ChunkPool> pool, std::unique_ptr<char[]> buffer, size_t size)
+    : _pool(std::move(pool))
+    , _buffer(std::move(buffer))
+    , _size(size)
+{
+}
+
+Chunk::~Chunk()
+{
+    if (_buffer)
+        _pool->Release(std::move(_buffer));
+}
+
+BodyStream::BodyStream(const StreamOptions& options) : _state(std::make_shared<State>(options))
+{
+}
+
+BodyStream::~BodyStream()
+{
+    // The request notices on its next progress callback.
+    if (_state)
+        _state->cancelled = true;
+}
+
+std::optional<Chunk> BodyStream::Next()
+{
+    std::unique_lock<std::mutex> lock(_state->mtx);
+    _state->cv.wait(lock, [this] { return !_state->ready.empty() || _state->done; });
+
+    if (_state->ready.empty())
+        return std::nullopt;
+
+    auto chunk = std::move(_state->ready.front());
+    _state->ready.pop_front();
+    return chunk;
+}
+
+cprex::Response BodyStream::Response()
+{
+    std::unique_lock<std::mutex> lock(_state->mtx);
+    _state->cv.wait(lock, [this] { return _state->done; });
+    return *_state->response;
+}
+
+void BodyStream::attach(const std::shared_ptr<State>& state, Session& session)
+{
+    // A new attempt, whatever the previous one left over wasn't handed out.
+    state->session  = &session;
+    state->curl     = session._session.GetCurlHolder()->handle;
+    state->accepted = std::nullopt;
+    state->paused   = false;
+    state->wrote    = false;
+    state->used     = 0;
+    state->rejected.clear();
+
+    curl_easy_setopt(state->curl, CURLOPT_WRITEFUNCTION, &BodyStream::write);
+    curl_easy_setopt(state->curl, CURLOPT_WRITEDATA, state.get());
+    curl_easy_setopt(state->curl, CURLOPT_XFERINFOFUNCTION, &BodyStream::progress);
+    curl_easy_setopt(state->curl, CURLOPT_XFERINFODATA, state.get());
+    curl_easy_setopt(state->curl, CURLOPT_NOPROGRESS, 0L);
+}
+
+void BodyStream::finish(const std::shared_ptr<State>& state, cprex::Response response)
+{
+    if (state->accepted.value_or(false))
+        publish(*state);
+    else
+        response.text = std::move(state->rejected);
+    if (state->buffer)
+        state->pool->Release(std::move(state->buffer));
+
+    // The callbacks are removed once the session is back in its pool.
+    state->session = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        state->response = std::move(response);
+        state->done     = true;
+    }
+    state->cv.notify_all();
+}
+
+void BodyStream::publish(State& state)
+{
+    if (!state.used)
+        return;
+
+    // From now on the request can't be attempted again without handing out parts of the body twice.
+    state.session->_committed = true;
+    {
+        std::lock_guard<std::mutex> lock(state.mtx);
+        state.ready.emplace_back(state.pool, std::move(state.buffer), state.used);
+    }
+    state.cv.notify_one();
+    state.used = 0;
+}
+
+size_t BodyStream::write(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    auto&        state = *static_cast<State*>(userdata);
+    const size_t total = size * nmemb;
+
+    if (!state.accepted)
+    {
+        long status_code = 0;
+        curl_easy_getinfo(state.curl, CURLINFO_RESPONSE_CODE, &status_code);
+        state.accepted = StatusCode::Succeeded(status_code);
+    }
+    if (!*state.accepted)
+    {
+        state.rejected.append(ptr, total);
+        return total;
+    }
+
+    // Take all or nothing, libcurl calls again with the same data once unpaused.
+    const size_t chunkSize = state.pool->ChunkSize();
+    const size_t space     = state.buffer ? chunkSize - state.used : 0;
+    const size_t needed    = total > space ? (total - space + chunkSize - 1) / chunkSize : 0;
+    if (needed > state.pool->Available())
+    {
+        state.paused = true;
+        return CURL_WRITEFUNC_PAUSE;
+    }
+
+    state.wrote = true;
+
+    size_t done = 0;
+    while (done < total)
+    {
+        if (!state.buffer)
+            state.buffer = state.pool->Acquire();
+
+        const size_t n = std::min(total - done, chunkSize - state.used);
+        std::memcpy(state.buffer.get() + state.used, ptr + done, n);
+        state.used += n;
+        done += n;
+
+        if (state.used == chunkSize)
+            publish(state);
+    }
+    return total;
+}
+
+int BodyStream::progress(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    auto& state = *static_cast<State*>(userdata);
+
+    if (state.cancelled)
+    {
+        // Aborted by the consumer, which is no failure worth another attempt.
+        state.session->_committed = true;
+        return 1;
+    }
+
+    // Hand out what has arrived so far once the data stalls rather than waiting for a full chunk, e.g. for slow NDJSON
+    // streams.
+    if (state.accepted.value_or(false) && !state.wrote)
+        publish(state);
+    state.wrote = false;
+
+    if (state.paused && state.pool->Available())
+    {
+        state.paused = false;
+        curl_easy_pause(state.curl, CURLPAUSE_CONT);
+    }
+    return 0;
+}
+}
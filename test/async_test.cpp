@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "include/cprex/cprex.h"
+
+namespace cprex::test
+{
+// A Session without named config makes AcquireSession() throw on the worker.
+static void ExpectThrown(AsyncResponse& response)
+{
+    try
+    {
+        response.get();
+        FAIL() << "No exception";
+    }
+    catch (std::exception* e)
+    {
+        delete e;
+    }
+}
+
+TEST(Async, FailureReachesCaller)
+{
+    Session session;
+
+    auto response = session.GetAsync(Path("/"));
+    ExpectThrown(response);
+}
+
+TEST(Async, WorkersSurviveFailures)
+{
+    Session session;
+
+    // More failing requests than there are workers.
+    std::vector<AsyncResponse> responses;
+    for (size_t i = 0; i < Factory::Workers().Threads() + 1; ++i)
+        responses.push_back(session.GetAsync(Path("/")));
+    for (auto& response : responses)
+        ExpectThrown(response);
+}
+
+TEST(Async, DownloadFailureReachesCaller)
+{
+    Session session;
+
+    auto response = session.DownloadAsync(cpr::fs::temp_directory_path() / "cprex_async_test.bin", Path("/"));
+    ExpectThrown(response);
+}
+}
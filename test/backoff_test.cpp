@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/cprex/backoff.h"
+
+using namespace std::chrono_literals;
+
+namespace cprex::test
+{
+// Median of many delays the policy gives for attempt, in milliseconds.
+static double Median(const BackofPolicy& policy, size_t attempt)
+{
+    std::vector<int64_t> delays(10001);
+    for (auto& delay : delays)
+        delay = policy(attempt).count();
+
+    std::nth_element(delays.begin(), delays.begin() + delays.size() / 2, delays.end());
+    return static_cast<double>(delays[delays.size() / 2]);
+}
+
+TEST(Backoff, CappedExponentialDoubles)
+{
+    auto policy = Backoff::CappedExponential(100ms, 10min);
+
+    EXPECT_EQ(policy(0), 100ms);
+    EXPECT_EQ(policy(1), 200ms);
+    EXPECT_EQ(policy(5), 3200ms);
+}
+
+TEST(Backoff, CappedAtMaxDelay)
+{
+    for (const auto& policy : {Backoff::CappedExponential(100ms, 1s), Backoff::FullJitter(100ms, 1s),
+             Backoff::EqualJitter(100ms, 1s), Backoff::DecorrelatedJitterV2(100ms, 1s)})
+    {
+        for (size_t attempt : {10u, 62u, 1000u})
+        {
+            const auto delay = policy(attempt);
+            EXPECT_LE(delay, 1s);
+            EXPECT_GE(delay, 0ms);
+        }
+    }
+}
+
+TEST(Backoff, FullJitterMedian)
+{
+    auto policy = Backoff::FullJitter(100ms, 10min);
+
+    EXPECT_NEAR(Median(policy, 0), 100, 10);
+    EXPECT_NEAR(Median(policy, 3), 800, 80);
+}
+
+TEST(Backoff, EqualJitterMedian)
+{
+    auto policy = Backoff::EqualJitter(100ms, 10min);
+
+    EXPECT_NEAR(Median(policy, 0), 100, 10);
+    EXPECT_NEAR(Median(policy, 3), 800, 80);
+
+    // Never below half of the exponential delay.
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_GE(policy(3), 533ms);
+}
+
+TEST(Backoff, DecorrelatedJitterV2Median)
+{
+    auto policy = Backoff::DecorrelatedJitterV2(100ms, 10min);
+
+    // Polly's constants give a first median of about 0.9 * medianFirstDelay.
+    EXPECT_NEAR(Median(policy, 0), 90, 10);
+
+    // From then on the median doubles with every attempt.
+    for (size_t attempt = 2; attempt < 6; ++attempt)
+        EXPECT_NEAR(Median(policy, attempt + 1) / Median(policy, attempt), 2.0, 0.2) << "attempt " << attempt;
+}
+}
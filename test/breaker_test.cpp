@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include "include/cprex/breaker.h"
+
+using namespace std::chrono_literals;
+
+namespace cprex::test
+{
+// Opens at half of 10 requests failed, and lets probes through right away when open.
+static BreakerOptions Options()
+{
+    BreakerOptions options;
+    options.failureRatio      = 0.5;
+    options.minimumThroughput = 10;
+    options.breakDuration     = 0s;
+    return options;
+}
+
+static void RecordMany(CircuitBreaker& breaker, size_t successes, size_t failures)
+{
+    for (size_t i = 0; i < successes; ++i)
+        breaker.Record(true);
+    for (size_t i = 0; i < failures; ++i)
+        breaker.Record(false);
+}
+
+TEST(CircuitBreaker, DisabledByDefault)
+{
+    EXPECT_EQ(BreakerOptions().failureRatio, 0);
+}
+
+TEST(CircuitBreaker, OpensAtFailureRatio)
+{
+    CircuitBreaker breaker(Options());
+
+    RecordMany(breaker, 5, 4);
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::Closed);
+
+    breaker.Record(false);
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::Open);
+}
+
+TEST(CircuitBreaker, NeedsMinimumThroughput)
+{
+    CircuitBreaker breaker(Options());
+
+    RecordMany(breaker, 0, 9);
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::Closed);
+    EXPECT_TRUE(breaker.Allow());
+}
+
+TEST(CircuitBreaker, RejectsWhileOpen)
+{
+    auto options          = Options();
+    options.breakDuration = 60s;
+    CircuitBreaker breaker(options);
+
+    RecordMany(breaker, 0, 10);
+    EXPECT_FALSE(breaker.Allow());
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::Open);
+}
+
+TEST(CircuitBreaker, SuccessfulProbeCloses)
+{
+    CircuitBreaker breaker(Options());
+    RecordMany(breaker, 0, 10);
+
+    EXPECT_TRUE(breaker.Allow());
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::HalfOpen);
+    EXPECT_FALSE(breaker.Allow());
+
+    breaker.Record(true);
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::Closed);
+    EXPECT_TRUE(breaker.Allow());
+
+    // The failures before don't count any more.
+    RecordMany(breaker, 0, 9);
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::Closed);
+}
+
+TEST(CircuitBreaker, FailedProbeReopens)
+{
+    CircuitBreaker breaker(Options());
+    RecordMany(breaker, 0, 10);
+
+    EXPECT_TRUE(breaker.Allow());
+    breaker.Record(false);
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::Open);
+}
+
+TEST(CircuitBreaker, AbandonedProbeFreesSlot)
+{
+    CircuitBreaker breaker(Options());
+    RecordMany(breaker, 0, 10);
+
+    EXPECT_TRUE(breaker.Allow());
+    EXPECT_FALSE(breaker.Allow());
+
+    breaker.Abandon();
+    EXPECT_TRUE(breaker.Allow());
+    EXPECT_FALSE(breaker.Allow());
+
+    // Abandoning more than was allowed doesn't let extra probes through.
+    breaker.Abandon();
+    breaker.Abandon();
+    EXPECT_TRUE(breaker.Allow());
+    EXPECT_FALSE(breaker.Allow());
+}
+
+TEST(CircuitBreaker, LostProbesTimeOut)
+{
+    auto options         = Options();
+    options.probeTimeout = 0s;
+    CircuitBreaker breaker(options);
+    RecordMany(breaker, 0, 10);
+
+    EXPECT_TRUE(breaker.Allow());
+    EXPECT_TRUE(breaker.Allow());
+    EXPECT_EQ(breaker.GetState(), CircuitBreaker::State::HalfOpen);
+}
+
+TEST(CircuitBreaker, IsFailure)
+{
+    EXPECT_FALSE(CircuitBreaker::IsFailure(0, 200));
+    EXPECT_FALSE(CircuitBreaker::IsFailure(0, 404));
+    EXPECT_TRUE(CircuitBreaker::IsFailure(0, 408));
+    EXPECT_TRUE(CircuitBreaker::IsFailure(0, 429));
+    EXPECT_TRUE(CircuitBreaker::IsFailure(0, 503));
+    EXPECT_TRUE(CircuitBreaker::IsFailure(7, 0));
+}
+}
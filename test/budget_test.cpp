@@ -0,0 +1,75 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "include/cprex/budget.h"
+
+using namespace std::chrono_literals;
+
+namespace cprex::test
+{
+// Earns nothing over time, so the balance only changes by what the test does.
+static RetryBudgetOptions Options()
+{
+    RetryBudgetOptions options;
+    options.ratio               = 0.5;
+    options.minRetriesPerSecond = 0;
+    options.maxBalance          = 3;
+    return options;
+}
+
+TEST(RetryBudget, DisabledByDefault)
+{
+    EXPECT_EQ(RetryBudgetOptions().ratio, 0);
+}
+
+TEST(RetryBudget, StartsWithMaxBalance)
+{
+    RetryBudget budget(Options());
+
+    EXPECT_EQ(budget.Balance(), 3);
+    EXPECT_TRUE(budget.TryWithdraw());
+    EXPECT_TRUE(budget.TryWithdraw());
+    EXPECT_TRUE(budget.TryWithdraw());
+    EXPECT_FALSE(budget.TryWithdraw());
+    EXPECT_EQ(budget.Balance(), 0);
+}
+
+TEST(RetryBudget, SuccessesEarnRatio)
+{
+    RetryBudget budget(Options());
+    while (budget.TryWithdraw())
+    {
+    }
+
+    budget.Deposit();
+    EXPECT_EQ(budget.Balance(), 0.5);
+    EXPECT_FALSE(budget.TryWithdraw());
+
+    budget.Deposit();
+    EXPECT_TRUE(budget.TryWithdraw());
+    EXPECT_FALSE(budget.TryWithdraw());
+}
+
+TEST(RetryBudget, KeepsAtMostMaxBalance)
+{
+    RetryBudget budget(Options());
+
+    for (int i = 0; i < 10; ++i)
+        budget.Deposit();
+    EXPECT_EQ(budget.Balance(), 3);
+}
+
+TEST(RetryBudget, EarnsOverTime)
+{
+    auto options                = Options();
+    options.minRetriesPerSecond = 100;
+    RetryBudget budget(options);
+    while (budget.TryWithdraw())
+    {
+    }
+
+    std::this_thread::sleep_for(50ms);
+    EXPECT_TRUE(budget.TryWithdraw());
+}
+}
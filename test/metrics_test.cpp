@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "include/cprex/metrics.h"
+
+namespace cprex::test
+{
+static HistogramSnapshot Snapshot(const Histogram& histogram)
+{
+    HistogramSnapshot snapshot;
+    histogram.AddTo(snapshot.counts, snapshot.sum);
+    for (uint64_t count : snapshot.counts)
+        snapshot.count += count;
+    return snapshot;
+}
+
+TEST(Histogram, SmallValuesAreExact)
+{
+    for (uint64_t value = 0; value < 16; ++value)
+    {
+        EXPECT_EQ(Histogram::BucketOf(value), value);
+        EXPECT_EQ(Histogram::LowerBound(value), value);
+    }
+}
+
+TEST(Histogram, BucketsCoverValues)
+{
+    for (uint64_t value = 0; value < 1'000'000; value += 1 + value / 100)
+    {
+        const size_t bucket = Histogram::BucketOf(value);
+        EXPECT_LE(Histogram::LowerBound(bucket), value);
+        EXPECT_GT(Histogram::LowerBound(bucket + 1), value);
+        // 16 buckets per power of two keep the error within 1/16.
+        EXPECT_LE(Histogram::LowerBound(bucket + 1) - Histogram::LowerBound(bucket), value / 16 + 1);
+    }
+}
+
+TEST(Histogram, HugeValuesGoToLastBucket)
+{
+    EXPECT_EQ(Histogram::BucketOf(uint64_t(1) << 40), Histogram::Buckets - 1);
+    EXPECT_EQ(Histogram::BucketOf(UINT64_MAX), Histogram::Buckets - 1);
+}
+
+TEST(Histogram, EmptyPercentile)
+{
+    EXPECT_EQ(HistogramSnapshot().Percentile(0.5), 0u);
+}
+
+TEST(Histogram, Percentiles)
+{
+    Histogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value)
+        histogram.Record(value);
+    const auto snapshot = Snapshot(histogram);
+
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.sum, 500500u);
+
+    // The upper bound of the bucket holding the percentile, so at most 1/16 above.
+    for (double percentile : {0.5, 0.9, 0.99})
+    {
+        const auto expected = static_cast<uint64_t>(percentile * 1000);
+        EXPECT_GE(snapshot.Percentile(percentile), expected);
+        EXPECT_LE(snapshot.Percentile(percentile), expected + expected / 16);
+    }
+    EXPECT_EQ(snapshot.Percentile(0), 1u);
+    EXPECT_GE(snapshot.Percentile(1), 1000u);
+}
+
+TEST(Histogram, CountUpTo)
+{
+    Histogram histogram;
+    for (uint64_t value : {1, 5, 10, 100, 1000})
+        histogram.Record(value);
+    const auto snapshot = Snapshot(histogram);
+
+    EXPECT_EQ(snapshot.CountUpTo(0), 0u);
+    EXPECT_EQ(snapshot.CountUpTo(10), 3u);
+    EXPECT_EQ(snapshot.CountUpTo(UINT32_MAX), 5u);
+}
+
+TEST(Metrics, RejectedRetries)
+{
+    Metrics metrics;
+    metrics.RecordRejectedRetry(RetryRejection::CircuitOpen);
+    metrics.RecordRejectedRetry(RetryRejection::CircuitOpen);
+    metrics.RecordRejectedRetry(RetryRejection::BudgetExhausted);
+
+    const auto snapshot = metrics.Snapshot();
+    EXPECT_EQ(snapshot.rejectedRetries[static_cast<size_t>(RetryRejection::CircuitOpen)], 2u);
+    EXPECT_EQ(snapshot.rejectedRetries[static_cast<size_t>(RetryRejection::BudgetExhausted)], 1u);
+
+    const auto text = Metrics::Prometheus({{"api", snapshot}});
+    EXPECT_NE(text.find("cprex_retries_rejected_total{session=\"api\",reason=\"circuit_open\"} 2"), std::string::npos);
+    EXPECT_NE(text.find("reason=\"budget_exhausted\"} 1"), std::string::npos);
+}
+}
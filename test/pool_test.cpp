@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include "include/cprex/cprex.h"
+#include "server.h"
+
+using namespace std::chrono_literals;
+
+namespace cprex::test
+{
+struct PoolCounters
+{
+    size_t created = 0;
+    size_t resets  = 0;
+};
+
+static std::shared_ptr<SessionPool> NewPool(PoolCounters& counters, PoolOptions options, bool reusable = true)
+{
+    return std::make_shared<SessionPool>(
+        [&counters] {
+            ++counters.created;
+            return std::make_unique<Session>();
+        },
+        [&counters, reusable](Session&) {
+            ++counters.resets;
+            return reusable;
+        },
+        options);
+}
+
+TEST(SessionPool, FillCreatesMinSize)
+{
+    PoolCounters counters;
+    auto         pool = NewPool(counters, {.minSize = 2, .maxSize = 4});
+
+    pool->Fill();
+
+    EXPECT_EQ(pool->Idle(), 2u);
+    EXPECT_EQ(counters.created, 2u);
+}
+
+TEST(SessionPool, FirstAcquireFills)
+{
+    PoolCounters counters;
+    auto         pool = NewPool(counters, {.minSize = 2, .maxSize = 4});
+    EXPECT_EQ(counters.created, 0u);
+
+    auto lease = pool->Acquire();
+
+    EXPECT_EQ(counters.created, 2u);
+    EXPECT_EQ(pool->Idle(), 1u);
+}
+
+TEST(SessionPool, ReleasedSessionIsResetAndReused)
+{
+    PoolCounters counters;
+    auto         pool = NewPool(counters, {.minSize = 0, .maxSize = 4});
+
+    Session* first;
+    {
+        auto lease = pool->Acquire();
+        first      = &*lease;
+    }
+    EXPECT_EQ(counters.resets, 1u);
+    EXPECT_EQ(pool->Idle(), 1u);
+
+    auto lease = pool->Acquire();
+    EXPECT_EQ(&*lease, first);
+    EXPECT_EQ(counters.created, 1u);
+    EXPECT_EQ(pool->Idle(), 0u);
+}
+
+TEST(SessionPool, FailedResetDropsSession)
+{
+    PoolCounters counters;
+    auto         pool = NewPool(counters, {.minSize = 0, .maxSize = 4}, false);
+
+    pool->Acquire();
+
+    EXPECT_EQ(counters.resets, 1u);
+    EXPECT_EQ(pool->Idle(), 0u);
+}
+
+TEST(SessionPool, KeepsAtMostMaxSize)
+{
+    PoolCounters counters;
+    auto         pool = NewPool(counters, {.minSize = 0, .maxSize = 2});
+
+    {
+        auto a = pool->Acquire();
+        auto b = pool->Acquire();
+        auto c = pool->Acquire();
+    }
+
+    EXPECT_EQ(counters.created, 3u);
+    EXPECT_EQ(pool->Idle(), 2u);
+}
+
+TEST(SessionPool, EvictsIdleBeyondMinSize)
+{
+    PoolCounters counters;
+    auto         pool = NewPool(counters, {.minSize = 1, .maxSize = 4, .idleTimeout = 0s});
+
+    {
+        auto a = pool->Acquire();
+        auto b = pool->Acquire();
+        auto c = pool->Acquire();
+    }
+    std::this_thread::sleep_for(10ms);
+
+    // All but minSize have been idle for too long, the one left is handed out.
+    auto lease = pool->Acquire();
+    EXPECT_EQ(pool->Idle(), 0u);
+    EXPECT_EQ(counters.created, 3u);
+}
+
+TEST(SessionPool, RequestOptionsDontCarryOverToNextLease)
+{
+    TestServer server;
+    Factory::PrepareSession("pool-bearer", server.Url(), {}, {}, {}, {0, 0, DefaultJitterBackofPolicy},
+        {.pool = {.minSize = 0, .maxSize = 4}});
+
+    {
+        auto lease = Factory::AcquireSession("pool-bearer");
+        lease->Get(Path("/first"), cpr::Bearer {"secret"});
+    }
+    // The session which got the credentials isn't given back.
+    EXPECT_EQ(Factory::WarmupStats("pool-bearer").idleSessions, 0u);
+    {
+        auto lease = Factory::AcquireSession("pool-bearer");
+        lease->Get(Path("/second"));
+    }
+    EXPECT_EQ(Factory::WarmupStats("pool-bearer").idleSessions, 1u);
+
+    const auto requests = server.Requests();
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_NE(requests[0].find("Authorization: Bearer secret"), std::string::npos);
+    EXPECT_EQ(requests[1].find("Authorization"), std::string::npos);
+}
+
+TEST(SessionPool, WriteCallbackDoesntCarryOverToNextLease)
+{
+    TestServer server([](const std::string&) { return TestServer::Reply("body"); });
+    Factory::PrepareSession("pool-write", server.Url(), {}, {}, {}, {0, 0, DefaultJitterBackofPolicy},
+        {.pool = {.minSize = 0, .maxSize = 4}});
+
+    std::string written;
+    {
+        auto lease = Factory::AcquireSession("pool-write");
+        lease->Download(cpr::WriteCallback {[&written](std::string_view data, intptr_t) {
+            written += data;
+            return true;
+        }},
+            Path("/first"));
+    }
+    EXPECT_EQ(written, "body");
+    EXPECT_EQ(Factory::WarmupStats("pool-write").idleSessions, 0u);
+    {
+        auto lease    = Factory::AcquireSession("pool-write");
+        auto response = lease->Get(Path("/second"));
+        EXPECT_EQ(response.text, "body");
+    }
+    EXPECT_EQ(written, "body");
+}
+}
@@ -0,0 +1,62 @@
+#include <fstream>
+#include <iterator>
+
+#include <gtest/gtest.h>
+
+#include "include/cprex/cprex.h"
+#include "server.h"
+
+namespace cprex::test
+{
+static std::string Content(size_t size)
+{
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        content[i] = static_cast<char>(i % 251);
+    return content;
+}
+
+static std::string ReadFile(const cpr::fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+TEST(RangedDownload, CutRangeResumesWhereItStopped)
+{
+    const auto content = Content(1000);
+    // Only touched by the server thread.
+    size_t gets = 0;
+
+    // Both ranges break off halfway on their first attempt.
+    TestServer server([&content, &gets](const std::string& head) {
+        const bool get = head.rfind("GET ", 0) == 0;
+        return TestServer::Ranged(head, content, get && ++gets <= 2);
+    });
+    Factory::PrepareSession("ranged-cut", server.Url(), {}, {}, {}, {2, 0, DefaultJitterBackofPolicy});
+
+    const auto path     = cpr::fs::temp_directory_path() / "cprex_ranged_test.bin";
+    auto       session  = Factory::CreateSession("ranged-cut");
+    auto       response = session.DownloadFile(path, {.connections = 2, .minRangeSize = 100}, Path("/file"));
+
+    EXPECT_EQ(response.error.code, cpr::ErrorCode::OK);
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_EQ(ReadFile(path), content);
+    // The HEAD and two per range.
+    EXPECT_EQ(response.attempts.size(), 5u);
+
+    // Each range continues after the 250 bytes it got.
+    const auto requests = server.Requests();
+    ASSERT_EQ(requests.size(), 5u);
+    size_t resumed = 0;
+    for (const auto& request : requests)
+    {
+        if (request.find("Range: bytes=250-499") != std::string::npos ||
+            request.find("Range: bytes=750-999") != std::string::npos)
+            ++resumed;
+    }
+    EXPECT_EQ(resumed, 2u);
+
+    cpr::fs::remove(path);
+}
+}
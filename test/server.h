@@ -0,0 +1,172 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#    include <winsock2.h>
+#    pragma comment(lib, "ws2_32.lib")
+#else
+#    include <arpa/inet.h>
+#    include <netinet/in.h>
+#    include <sys/socket.h>
+#    include <unistd.h>
+#endif
+
+namespace cprex::test
+{
+// Minimal HTTP/1.1 server on 127.0.0.1 answering every request via its handler, an empty 200 by default, and closing
+// the connection.
+// Keeps the received request heads, so tests can check what was actually sent.
+class TestServer final
+{
+public:
+    // Bytes sent back for a request head, which may as well be less than its Content-Length announces.
+    using Handler = std::function<std::string(const std::string& head)>;
+
+    static std::string Reply(const std::string& body, const std::string& status = "200 OK")
+    {
+        return "HTTP/1.1 " + status + "\r\nContent-Length: " + std::to_string(body.size()) +
+               "\r\nConnection: close\r\n\r\n" + body;
+    }
+
+    // Serves content like a file server supporting byte ranges, only the header fields to a HEAD. With cut, the
+    // connection closes after half of the bytes the reply announces.
+    static std::string Ranged(const std::string& head, const std::string& content, bool cut = false)
+    {
+        std::string status = "200 OK";
+        std::string fields;
+        size_t      begin = 0;
+        size_t      end   = content.size();
+
+        const auto range = head.find("\r\nRange: bytes=");
+        if (range != std::string::npos)
+        {
+            const size_t first = range + 15;
+            const size_t dash  = head.find('-', first);
+            const size_t eol   = head.find("\r\n", dash);
+            begin              = std::stoul(head.substr(first, dash - first));
+            if (eol > dash + 1)
+                end = std::stoul(head.substr(dash + 1, eol - dash - 1)) + 1;
+
+            status = "206 Partial Content";
+            fields = "Content-Range: bytes " + std::to_string(begin) + '-' + std::to_string(end - 1) + '/' +
+                     std::to_string(content.size()) + "\r\n";
+        }
+
+        const std::string reply = "HTTP/1.1 " + status + "\r\nAccept-Ranges: bytes\r\n" + fields +
+                                  "Content-Length: " + std::to_string(end - begin) + "\r\nConnection: close\r\n\r\n";
+        if (head.rfind("HEAD ", 0) == 0)
+            return reply;
+        return reply + content.substr(begin, cut ? (end - begin) / 2 : end - begin);
+    }
+
+    explicit TestServer(Handler handler = [](const std::string&) { return Reply(""); })
+        : _handler(std::move(handler))
+    {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+        _listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+        sockaddr_in address {};
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port        = 0;
+        bind(_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        listen(_listener, 16);
+
+        socklen_t length = sizeof(address);
+        getsockname(_listener, reinterpret_cast<sockaddr*>(&address), &length);
+        _port = ntohs(address.sin_port);
+
+        _thread = std::thread(&TestServer::run, this);
+    }
+
+    ~TestServer()
+    {
+        _stop = true;
+        close(_listener);
+        _thread.join();
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    TestServer(const TestServer&)            = delete;
+    TestServer& operator=(const TestServer&) = delete;
+
+    std::string Url() const
+    {
+        return "http://127.0.0.1:" + std::to_string(_port) + "/";
+    }
+
+    // Request line and header fields of all requests so far, in the order they arrived.
+    std::vector<std::string> Requests() const
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _requests;
+    }
+
+private:
+#ifdef _WIN32
+    using socklen_t = int;
+    using Socket    = SOCKET;
+
+    static void close(Socket s)
+    {
+        closesocket(s);
+    }
+#else
+    using Socket = int;
+
+    static void close(Socket s)
+    {
+        shutdown(s, SHUT_RDWR);
+        ::close(s);
+    }
+#endif
+
+    void run()
+    {
+        while (!_stop)
+        {
+            Socket client = accept(_listener, nullptr, nullptr);
+            if (_stop)
+                break;
+
+            std::string head;
+            char        buffer[4096];
+            while (head.find("\r\n\r\n") == std::string::npos)
+            {
+                const auto n = recv(client, buffer, sizeof(buffer), 0);
+                if (n <= 0)
+                    break;
+                head.append(buffer, n);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                _requests.push_back(head.substr(0, head.find("\r\n\r\n")));
+            }
+
+            const std::string reply = _handler(head);
+            send(client, reply.data(), static_cast<int>(reply.size()), 0);
+            close(client);
+        }
+    }
+
+    Handler           _handler;
+    Socket            _listener;
+    uint16_t          _port = 0;
+    std::atomic<bool> _stop = false;
+    std::thread       _thread;
+
+    mutable std::mutex       _mtx;
+    std::vector<std::string> _requests;
+};
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include "include/cprex/url.h"
+
+namespace cprex::test
+{
+TEST(ParsedUrl, SplitsComponents)
+{
+    ParsedUrl url("https://api.example.com:8443/v1/items?limit=10");
+
+    EXPECT_EQ(url.Scheme(), "https");
+    EXPECT_EQ(url.Host(), "api.example.com");
+    EXPECT_EQ(url.Port(), 8443);
+    EXPECT_EQ(url.Path(), "/v1/items?limit=10");
+    EXPECT_FALSE(url.HasCredentials());
+    EXPECT_EQ(url.User(), "");
+}
+
+TEST(ParsedUrl, DefaultPorts)
+{
+    EXPECT_EQ(ParsedUrl("http://example.com").Port(), 80);
+    EXPECT_EQ(ParsedUrl("https://example.com/").Port(), 443);
+    EXPECT_EQ(ParsedUrl("socks5h://proxy").Port(), 1080);
+    EXPECT_EQ(ParsedUrl("ftp://example.com").Port(), 0);
+}
+
+TEST(ParsedUrl, NoPath)
+{
+    ParsedUrl url("http://example.com");
+
+    EXPECT_EQ(url.Host(), "example.com");
+    EXPECT_EQ(url.Path(), "");
+}
+
+TEST(ParsedUrl, QueryWithoutPath)
+{
+    ParsedUrl url("http://example.com?a=1");
+
+    EXPECT_EQ(url.Host(), "example.com");
+    EXPECT_EQ(url.Path(), "?a=1");
+}
+
+TEST(ParsedUrl, Credentials)
+{
+    ParsedUrl url("http://user:p@ss@proxy.local:3128");
+
+    EXPECT_TRUE(url.HasCredentials());
+    EXPECT_EQ(url.User(), "user");
+    // The last '@' ends the credentials.
+    EXPECT_EQ(url.Password(), "p@ss");
+    EXPECT_EQ(url.Host(), "proxy.local");
+    EXPECT_EQ(url.Port(), 3128);
+}
+
+TEST(ParsedUrl, UserWithoutPassword)
+{
+    ParsedUrl url("http://user@proxy.local");
+
+    EXPECT_FALSE(url.HasCredentials());
+    EXPECT_EQ(url.User(), "user");
+    EXPECT_EQ(url.Password(), "");
+    EXPECT_EQ(url.Host(), "proxy.local");
+}
+
+TEST(ParsedUrl, WithoutScheme)
+{
+    ParsedUrl url("proxy.local:8080");
+
+    EXPECT_EQ(url.Scheme(), "");
+    EXPECT_EQ(url.Host(), "proxy.local");
+    EXPECT_EQ(url.Port(), 8080);
+}
+
+TEST(ParsedUrl, Ipv6)
+{
+    ParsedUrl url("http://[::1]:8080/path");
+
+    EXPECT_EQ(url.Host(), "[::1]");
+    EXPECT_EQ(url.Port(), 8080);
+    EXPECT_EQ(url.Path(), "/path");
+
+    ParsedUrl noPort("http://[fe80::1]/");
+    EXPECT_EQ(noPort.Host(), "[fe80::1]");
+    EXPECT_EQ(noPort.Port(), 80);
+}
+
+TEST(ParsedUrl, AtInPathIsNoCredential)
+{
+    ParsedUrl url("http://example.com/users/@me");
+
+    EXPECT_EQ(url.Host(), "example.com");
+    EXPECT_EQ(url.User(), "");
+    EXPECT_EQ(url.Path(), "/users/@me");
+}
+}
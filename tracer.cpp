@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstring>
+
+#include "include/cprex/random.h"
+#include "include/cprex/tracer.h"
+
+namespace cprex
+{
+Tracer::~Tracer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _cv.notify_one();
+    if (_thread.joinable())
+        _thread.join();
+
+    std::string out;
+    flush(out);
+
+    if (_file)
+        fclose(_file);
+}
+
+void Tracer::Open(const cpr::fs::path& path)
+{
+#ifdef _WIN32
+    FILE* file = _wfopen(path.c_str(), L"ab");
+#else
+    FILE* file = fopen(path.c_str(), "ab");
+#endif
+    if (!file)
+        throw new std::exception("Can't open trace file");
+
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_file)
+        fclose(_file);
+    _file = file;
+}
+
+void Tracer::SetFlushInterval(std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    _interval = interval;
+}
+
+void Tracer::SetOptions(const TraceOptions& options)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    _options = options;
+    _optionsVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
+Tracer::Ring::Ring(const TraceOptions& options)
+    : size(std::max<size_t>(options.ringSize, 1))
+    , maxSessionName(options.maxSessionName)
+    , maxData(std::min<size_t>(options.maxData, UINT32_MAX))
+    , events(size)
+    , payload(std::make_unique_for_overwrite<char[]>(size * (maxSessionName + maxData)))
+{
+}
+
+uint64_t Tracer::Sample(double rate)
+{
+    static std::atomic<uint64_t> next = 0;
+
+    if (rate <= 0 || (rate < 1 && Random::NextDouble() >= rate))
+        return 0;
+    return next.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void Tracer::Record(const std::string& session, uint64_t request, uint32_t attempt, curl_infotype type,
+    const char* data, size_t size)
+{
+    auto&          ring = this->ring();
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= ring.size)
+    {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const size_t index = head % ring.size;
+    const auto   now   = std::chrono::system_clock::now().time_since_epoch();
+    auto&        event = ring.events[index];
+    event.time       = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    event.request    = request;
+    event.attempt    = attempt;
+    event.size       = static_cast<uint32_t>(std::min<size_t>(size, UINT32_MAX));
+    event.type       = type;
+
+    // Encrypted payloads are of no use.
+    const bool tls = type == CURLINFO_SSL_DATA_IN || type == CURLINFO_SSL_DATA_OUT;
+    event.kept     = tls ? 0 : static_cast<uint32_t>(std::min(size, ring.maxData));
+    std::memcpy(ring.Data(index), data, event.kept);
+
+    event.sessionLength = static_cast<uint32_t>(std::min(session.size(), ring.maxSessionName));
+    std::memcpy(ring.Session(index), session.data(), event.sessionLength);
+
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+Tracer::Stats Tracer::GetStats() const
+{
+    return {_written.load(std::memory_order_relaxed), _dropped.load(std::memory_order_relaxed)};
+}
+
+Tracer::Ring& Tracer::ring()
+{
+    // Marks the ring as closed once its thread exits, the writer still drains it.
+    struct Owned
+    {
+        const Tracer*         owner   = nullptr;
+        uint32_t              version = 0;
+        std::shared_ptr<Ring> ring;
+
+        ~Owned()
+        {
+            if (ring)
+                ring->closed = true;
+        }
+    };
+    thread_local Owned owned;
+
+    if (owned.owner != this || owned.version != _optionsVersion.load(std::memory_order_relaxed))
+    {
+        if (owned.ring)
+            owned.ring->closed = true;
+
+        std::lock_guard<std::mutex> lock(_mtx);
+        owned.ring    = std::make_shared<Ring>(_options);
+        owned.owner   = this;
+        owned.version = _optionsVersion.load(std::memory_order_relaxed);
+        _rings.push_back(owned.ring);
+        if (!_thread.joinable())
+            _thread = std::thread(&Tracer::run, this);
+    }
+    return *owned.ring;
+}
+
+void Tracer::run()
+{
+    std::string out;
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (!_stop)
+    {
+        _cv.wait_for(lock, _interval);
+
+        lock.unlock();
+        flush(out);
+        lock.lock();
+    }
+}
+
+static const char* TypeName(curl_infotype type)
+{
+    switch (type)
+    {
+        case CURLINFO_TEXT:
+            return "text";
+        case CURLINFO_HEADER_IN:
+            return "header_in";
+        case CURLINFO_HEADER_OUT:
+            return "header_out";
+        case CURLINFO_DATA_IN:
+            return "data_in";
+        case CURLINFO_DATA_OUT:
+            return "data_out";
+        case CURLINFO_SSL_DATA_IN:
+            return "ssl_data_in";
+        case CURLINFO_SSL_DATA_OUT:
+            return "ssl_data_out";
+        default:
+            return "unknown";
+    }
+}
+
+static void AppendJsonString(std::string& out, const char* data, size_t size)
+{
+    static constexpr char Hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (size_t i = 0; i < size; ++i)
+    {
+        const auto c = static_cast<unsigned char>(data[i]);
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += static_cast<char>(c);
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else if (c == '\r')
+        {
+            out += "\\r";
+        }
+        else if (c < 0x20 || c >= 0x7f)
+        {
+            // Bodies may be binary, bytes beyond ASCII are written as if they were Latin-1.
+            out += "\\u00";
+            out += Hex[c >> 4];
+            out += Hex[c & 0xf];
+        }
+        else
+        {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+size_t Tracer::drain(std::string& out)
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        // Closed ones are dropped once drained, i.e. in the round after they were closed.
+        std::erase_if(_rings, [](const auto& ring) {
+            return ring->closed && ring->tail.load(std::memory_order_relaxed) == ring->head.load();
+        });
+        rings = _rings;
+    }
+
+    size_t count = 0;
+    for (const auto& ring : rings)
+    {
+        uint64_t       tail = ring->tail.load(std::memory_order_relaxed);
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail < head; ++tail, ++count)
+        {
+            const size_t index = tail % ring->size;
+            const auto&  event = ring->events[index];
+
+            out += "{\"time\":";
+            out += std::to_string(event.time);
+            out += ",\"session\":";
+            AppendJsonString(out, ring->Session(index), event.sessionLength);
+            out += ",\"request\":";
+            out += std::to_string(event.request);
+            out += ",\"attempt\":";
+            out += std::to_string(event.attempt);
+            out += ",\"type\":\"";
+            out += TypeName(event.type);
+            out += "\",\"size\":";
+            out += std::to_string(event.size);
+            if (event.kept)
+            {
+                out += ",\"data\":";
+                AppendJsonString(out, ring->Data(index), event.kept);
+            }
+            if (event.kept < event.size)
+                out += ",\"truncated\":true";
+            out += "}\n";
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    return count;
+}
+
+void Tracer::flush(std::string& out)
+{
+    out.clear();
+    const size_t count = drain(out);
+    if (!count)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        FILE*                       file = _file ? _file : stderr;
+        fwrite(out.data(), 1, out.size(), file);
+        fflush(file);
+    }
+    _written.fetch_add(count, std::memory_order_relaxed);
+}
+}
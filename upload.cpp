@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cstring>
+
+#include "include/cprex/upload.h"
+
+namespace cprex
+{
+UploadSource UploadSource::FromFile(const cpr::fs::path& path)
+{
+    UploadSource source;
+    source._state       = std::make_shared<State>();
+    source._state->file = std::make_unique<File>(path, File::Access::Read);
+    source._state->size = source._state->file->Size();
+    return source;
+}
+
+UploadSource UploadSource::FromBuffers(std::vector<std::string_view> buffers)
+{
+    UploadSource source;
+    source._state = std::make_shared<State>();
+
+    // Empty ones would only need skipping later.
+    std::erase_if(buffers, [](std::string_view buffer) { return buffer.empty(); });
+
+    source._state->offsets.reserve(buffers.size());
+    for (const auto& buffer : buffers)
+    {
+        source._state->offsets.push_back(source._state->size);
+        source._state->size += buffer.size();
+    }
+    source._state->buffers = std::move(buffers);
+    return source;
+}
+
+void UploadSource::attach(CURL* curl)
+{
+    seek(*_state, 0);
+
+    // Replaces whatever cpr prepared as body, the method set by cpr's preparation stays.
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, nullptr);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(_state->size));
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, &UploadSource::readCallback);
+    curl_easy_setopt(curl, CURLOPT_READDATA, _state.get());
+    // Redirects and authentication may make libcurl send the body again.
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, &UploadSource::seekCallback);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, _state.get());
+}
+
+void UploadSource::detach(CURL* curl)
+{
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, nullptr);
+    curl_easy_setopt(curl, CURLOPT_READDATA, nullptr);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, nullptr);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, nullptr);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(-1));
+    curl_easy_setopt(curl, CURLOPT_POST, 0L);
+}
+
+size_t UploadSource::read(State& state, char* buffer, size_t size)
+{
+    size = static_cast<size_t>(std::min<uint64_t>(size, state.size - state.position));
+
+    if (state.file)
+    {
+        const size_t read = state.file->ReadAt(state.position, buffer, size);
+        state.position += read;
+        return read;
+    }
+
+    size_t copied = 0;
+    while (copied < size)
+    {
+        const auto   current = state.buffers[state.current];
+        const size_t offset  = static_cast<size_t>(state.position - state.offsets[state.current]);
+        const size_t chunk   = std::min(size - copied, current.size() - offset);
+
+        std::memcpy(buffer + copied, current.data() + offset, chunk);
+        copied += chunk;
+        state.position += chunk;
+        if (offset + chunk == current.size())
+            ++state.current;
+    }
+    return copied;
+}
+
+bool UploadSource::seek(State& state, uint64_t offset)
+{
+    if (offset > state.size)
+        return false;
+
+    state.position = offset;
+    if (!state.buffers.empty())
+    {
+        // The last buffer starting at or before offset.
+        auto next     = std::upper_bound(state.offsets.begin(), state.offsets.end(), offset);
+        state.current = std::distance(state.offsets.begin(), next) - 1;
+    }
+    return true;
+}
+
+size_t UploadSource::readCallback(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+    try
+    {
+        return read(*static_cast<State*>(userdata), buffer, size * nitems);
+    }
+    catch (std::exception* e)
+    {
+        delete e;
+        return CURL_READFUNC_ABORT;
+    }
+}
+
+int UploadSource::seekCallback(void* userdata, curl_off_t offset, int origin)
+{
+    if (origin != SEEK_SET || offset < 0)
+        return CURL_SEEKFUNC_CANTSEEK;
+    return seek(*static_cast<State*>(userdata), static_cast<uint64_t>(offset)) ? CURL_SEEKFUNC_OK : CURL_SEEKFUNC_FAIL;
+}
+}
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <charconv>
+
+#include "include/cprex/url.h"
+
+namespace cprex
+{
+static uint16_t DefaultPort(std::string_view scheme)
+{
+    if (scheme == "http")
+        return 80;
+    if (scheme == "https")
+        return 443;
+    if (scheme.starts_with("socks"))
+        return 1080;
+    return 0;
+}
+
+ParsedUrl::ParsedUrl(std::string url) : _url(std::move(url))
+{
+    size_t authority = 0;
+    size_t schemeEnd = _url.find("://");
+    if (schemeEnd != std::string::npos)
+    {
+        _schemeEnd = schemeEnd;
+        authority  = schemeEnd + 3;
+    }
+
+    _pathBegin = _url.find_first_of("/?#", authority);
+    if (_pathBegin == std::string::npos)
+        _pathBegin = _url.size();
+
+    // The last '@' as passwords may contain one.
+    _userBegin     = authority;
+    _userEnd       = authority;
+    _passwordBegin = authority;
+    _passwordEnd   = authority;
+    _hostBegin     = authority;
+    size_t at      = _url.rfind('@', _pathBegin);
+    if (at != std::string::npos && at >= authority)
+    {
+        _hostBegin   = at + 1;
+        _userEnd     = _url.find(':', authority);
+        _passwordEnd = at;
+        if (_userEnd < at)
+            _passwordBegin = _userEnd + 1;
+        else
+            _userEnd = _passwordBegin = at;
+    }
+
+    // Skip the colons of IPv6 addresses as in [::1]:8080.
+    size_t portSearch = _hostBegin;
+    if (portSearch < _pathBegin && _url[portSearch] == '[')
+        portSearch = std::min(_url.find(']', portSearch), _pathBegin);
+
+    _hostEnd     = _pathBegin;
+    _port        = DefaultPort(Scheme());
+    size_t colon = _url.find(':', portSearch);
+    if (colon < _pathBegin)
+    {
+        _hostEnd = colon;
+        std::from_chars(_url.data() + colon + 1, _url.data() + _pathBegin, _port);
+    }
+}
+}
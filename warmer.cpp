@@ -0,0 +1,116 @@
+#include "include/cprex/cprex.h"
+#include "include/cprex/warmer.h"
+
+namespace cprex
+{
+ConnectionWarmer::ConnectionWarmer(std::string name, const WarmupOptions& options)
+    : _name(std::move(name))
+    , _options(options)
+{
+}
+
+void ConnectionWarmer::Start()
+{
+    schedule(std::chrono::milliseconds(0));
+}
+
+ConnectionWarmer::Stats ConnectionWarmer::GetStats() const
+{
+    return {_rounds.load(std::memory_order_relaxed), _warm.load(std::memory_order_relaxed),
+        _reopened.load(std::memory_order_relaxed), _multiplexed.load(std::memory_order_relaxed), 0};
+}
+
+void ConnectionWarmer::schedule(std::chrono::milliseconds delay)
+{
+    // The scheduler thread shall not block, the round runs on the maintenance thread rather than a worker serving
+    // requests.
+    Factory::RetryScheduler().Schedule(delay, [warmer = weak_from_this()] {
+        Factory::Maintenance().Submit([warmer] {
+            if (auto self = warmer.lock())
+                self->round();
+        });
+    });
+}
+
+void ConnectionWarmer::round()
+{
+    const uint64_t round = _rounds.fetch_add(1, std::memory_order_relaxed);
+    try
+    {
+        // A PING doesn't reopen a connection closed meanwhile, so every fourth round still sends requests.
+        if (_multiplexed && round % 4 != 0)
+            upkeep();
+        else
+            warm(round == 0);
+    }
+    catch (std::exception* e)
+    {
+        // The named config is gone.
+        delete e;
+        return;
+    }
+    schedule(_options.interval);
+}
+
+void ConnectionWarmer::warm(bool first)
+{
+    std::vector<SessionLease> leases;
+    for (size_t i = 0; i < _options.connections; ++i)
+        leases.push_back(Factory::AcquireSession(_name));
+
+    // Warm-up requests bypass the circuit breaker, so none are sent while it keeps requests away from the server.
+    const auto& breaker = leases.front()->_breaker;
+    if (breaker && breaker->GetState() != CircuitBreaker::State::Closed)
+        return;
+
+    // One after the other on the sessions' own handles, as each keeps the connection it opens. A multi handle would
+    // take them along when cleaned up.
+    const auto deadline = std::chrono::steady_clock::now() + _options.timeout;
+    size_t     warm = 0, multiplexed = 0;
+    for (auto& lease : leases)
+    {
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0)
+            break;
+
+        CURL* curl = lease->_session.GetCurlHolder()->handle;
+        lease->prepare(Session::Verb<&Session::PrepareHead> {});
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(left.count()));
+        const CURLcode curl_error = curl_easy_perform(curl);
+        // Pooled sessions have no timeout of their own.
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 0L);
+
+        // Any response tells the connection is open, HEAD may well be answered with an error status.
+        if (curl_error != CURLE_OK)
+            continue;
+        ++warm;
+
+        long version = 0, connects = 0;
+        curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+        if (version >= CURL_HTTP_VERSION_2_0)
+            ++multiplexed;
+        if (connects && !first)
+            _reopened.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    _warm        = warm;
+    _multiplexed = warm && multiplexed == warm;
+}
+
+void ConnectionWarmer::upkeep()
+{
+    std::vector<SessionLease> leases;
+    for (size_t i = 0; i < _options.connections; ++i)
+        leases.push_back(Factory::AcquireSession(_name));
+
+    // PINGs the connections of each session idle for longer.
+    const auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(_options.interval) / 2;
+    for (auto& lease : leases)
+    {
+        CURL* curl = lease->_session.GetCurlHolder()->handle;
+        curl_easy_setopt(curl, CURLOPT_UPKEEP_INTERVAL_MS, static_cast<long>(idle.count()));
+        curl_easy_upkeep(curl);
+    }
+}
+}
@@ -0,0 +1,71 @@
+#include "include/cprex/workers.h"
+
+namespace cprex
+{
+WorkerPool::WorkerPool(size_t threads)
+{
+    if (!threads)
+        threads = 1;
+
+    _threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        _threads.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _cv.notify_all();
+
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+void WorkerPool::Submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _jobs.push_back(std::move(job));
+    }
+    _cv.notify_one();
+}
+
+size_t WorkerPool::Queued() const
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _jobs.size();
+}
+
+void WorkerPool::run()
+{
+    while (1)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cv.wait(lock, [this] { return _stop || !_jobs.empty(); });
+            if (_jobs.empty())
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        // Jobs are expected to report their failures themselves, the thread has to survive anyway.
+        try
+        {
+            job();
+        }
+        catch (std::exception* e)
+        {
+            delete e;
+        }
+        catch (...)
+        {
+        }
+    }
+}
+}